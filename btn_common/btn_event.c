@@ -0,0 +1,539 @@
+/*
+ *  Filename: btn_event.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Publishing of button gestures to local subscribers, shared by the
+ *  button daemons and their subscribers.
+ *
+ *  The daemon binds a Unix datagram socket. A subscriber binds its own
+ *  socket (autobind) and sends a request to the daemon socket:
+ *  - "subscribe": each gesture is sent to it as a BTN_EVENT_t datagram
+ *  - "ring": each gesture is written to a ring buffer in shared memory
+ *    (memfd) and the eventfd of the subscriber is incremented. The
+ *    reply carries the memfd and the eventfd, so a subscriber can
+ *    wait for events with poll() and read them without any system call
+ *    but the read of the eventfd. The memfd is sealed, subscribers can
+ *    only map it read only.
+ *  - "unsubscribe"
+ *  Publishing never blocks the daemon: datagrams which do not fit into
+ *  the socket buffer of a subscriber are dropped, a ring subscriber
+ *  which does not keep up loses the oldest events (visible as a gap in
+ *  the sequence numbers). Subscribers whose socket is closed are
+ *  removed.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <grp.h>
+
+#include "btn_event.h"
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010   // Linux 5.1
+#endif
+
+/* time to wait for the reply to a ring subscription (ms) */
+#define REPLY_TIMEOUT 1000
+
+/* subscribers */
+static struct {
+   struct sockaddr_un addr;
+   socklen_t len;
+   int efd;                   // ring subscriber, -1 for datagrams
+} subs[BTN_MAX_SUBSCRIBERS];
+static int num_subs=0;
+
+static int sock=-1;
+static struct sockaddr_un sock_addr;
+static int ring_fd=-1;
+static BTN_RING_t *ring=NULL;
+static uint32_t seq=0;
+
+
+/*********************************************************************
+ * Function:    findSubscriber()
+ *
+ * Description: Returns the index of a subscriber, -1 if not found
+ *
+ ********************************************************************/
+static int findSubscriber(const struct sockaddr_un *addr, socklen_t len)
+{
+   int i;
+
+   for (i=0; i<num_subs; i++) {
+      if (subs[i].len == len && memcmp(&subs[i].addr, addr, len) == 0)
+         return i;
+   }
+   return -1;
+}
+
+/*********************************************************************
+ * Function:    removeSubscriber()
+ *
+ * Description: Removes a subscriber, the last one takes its index
+ *
+ ********************************************************************/
+static void removeSubscriber(int i)
+{
+   if (subs[i].efd >= 0)
+      close(subs[i].efd);
+   subs[i] = subs[--num_subs];
+}
+
+/*********************************************************************
+ * Function:    pruneSubscribers()
+ *
+ * Description: Removes the subscribers whose socket is closed. Ring
+ *              subscribers are not sent anything, so this is checked
+ *              when the subscriber list is full.
+ *
+ ********************************************************************/
+static void pruneSubscribers(void)
+{
+   int i, fd;
+
+   fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   if (fd < 0)
+      return;
+   for (i=num_subs-1; i>=0; i--) {
+      if (connect(fd, (struct sockaddr *)&subs[i].addr, subs[i].len) < 0 &&
+          (errno == ECONNREFUSED || errno == ENOENT))
+         removeSubscriber(i);
+   }
+   close(fd);
+}
+
+/*********************************************************************
+ * Function:    replyRing()
+ *
+ * Description: Sends the memfd of the ring buffer and the eventfd of
+ *              a ring subscriber to it
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int replyRing(int i)
+{
+   union {
+      struct cmsghdr hdr;
+      char b[CMSG_SPACE(2*sizeof(int))];
+   } ctrl;
+   struct iovec iov = { BTN_SUBSCRIBE_RING, sizeof(BTN_SUBSCRIBE_RING) };
+   struct msghdr msg;
+   struct cmsghdr *cmsg;
+   int fds[2] = { ring_fd, subs[i].efd };
+
+   memset(&msg, 0, sizeof(msg));
+   memset(&ctrl, 0, sizeof(ctrl));
+   msg.msg_name = &subs[i].addr;
+   msg.msg_namelen = subs[i].len;
+   msg.msg_iov = &iov;
+   msg.msg_iovlen = 1;
+   msg.msg_control = ctrl.b;
+   msg.msg_controllen = sizeof(ctrl.b);
+   cmsg = CMSG_FIRSTHDR(&msg);
+   cmsg->cmsg_level = SOL_SOCKET;
+   cmsg->cmsg_type = SCM_RIGHTS;
+   cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+   memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+   return (sendmsg(sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 ? -1 : 0);
+}
+
+
+/*********************************************************************
+ * Function:    btnEventInit()
+ *
+ * Description: Creates the daemon socket, a stale socket file is
+ *              replaced, and the ring buffer. The socket is accessible
+ *              to root and to the group BTN_EVENT_GROUP, if it exists.
+ *
+ * Parameters:  path - socket file
+ *
+ * Return:      socket (non blocking) to be watched for POLLIN by the
+ *              event loop, -1 on error
+ *
+ ********************************************************************/
+int btnEventInit(const char *path)
+{
+   struct group *grp;
+   struct stat st;
+
+   if (strlen(path) >= sizeof(sock_addr.sun_path)) {
+      fprintf(stderr, "Socket path too long: %s\n", path);
+      return -1;
+   }
+   memset(&sock_addr, 0, sizeof(sock_addr));
+   sock_addr.sun_family = AF_UNIX;
+   strcpy(sock_addr.sun_path, path);
+
+   ring_fd = memfd_create("buttond-events", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+   if (ring_fd < 0 || ftruncate(ring_fd, sizeof(BTN_RING_t)) < 0) {
+      fprintf(stderr, "Unable to create ring buffer: %s\n", strerror(errno));
+      goto error;
+   }
+   ring = mmap(NULL, sizeof(BTN_RING_t), PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+   if (ring == MAP_FAILED) {
+      fprintf(stderr, "mmap() failed: %s\n", strerror(errno));
+      ring = NULL;
+      goto error;
+   }
+   ring->magic = BTN_RING_MAGIC;
+   ring->size = BTN_RING_SIZE;
+   // Only the mapping above stays writable: subscribers get the same
+   // memfd, the seals keep them from mapping it writable, writing or
+   // resizing it. Without the seals the ring is not offered.
+   if (fcntl(ring_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+             F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) < 0) {
+      fprintf(stderr, "Unable to seal ring buffer, ring subscriptions disabled: %s\n",
+              strerror(errno));
+      close(ring_fd);
+      ring_fd = -1;
+   }
+
+   sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if (sock < 0) {
+      fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+      goto error;
+   }
+   if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+      unlink(path);
+   if (bind(sock, (struct sockaddr *)&sock_addr, sizeof(sock_addr)) < 0) {
+      fprintf(stderr, "Bind %s: %s\n", path, strerror(errno));
+      close(sock);
+      sock = -1;
+      goto error;
+   }
+   // Root and the members of the subscriber group may subscribe
+   grp = getgrnam(BTN_EVENT_GROUP);
+   if (grp && chown(path, -1, grp->gr_gid) < 0)
+      fprintf(stderr, "chown %s: %s\n", path, strerror(errno));
+   chmod(path, grp ? 0660 : 0600);
+   return sock;
+
+error:
+   btnEventCleanup();
+   return -1;
+}
+
+/*********************************************************************
+ * Function:    btnEventRequest()
+ *
+ * Description: Handles the requests of subscribers. To be called when
+ *              the socket is readable.
+ *
+ ********************************************************************/
+void btnEventRequest(void)
+{
+   struct sockaddr_un addr;
+   socklen_t len;
+   char b[32];
+   int n, i, is_ring;
+
+   for (;;) {
+      len = sizeof(addr);
+      n = recvfrom(sock, b, sizeof(b)-1, 0, (struct sockaddr *)&addr, &len);
+      if (n < 0)
+         break;
+      b[n] = 0;
+      if (len <= sizeof(sa_family_t)) {
+         fprintf(stderr, "Request \"%s\" from unbound socket ignored\n", b);
+         continue;
+      }
+
+      i = findSubscriber(&addr, len);
+      if (strcmp(b, BTN_UNSUBSCRIBE) == 0) {
+         if (i >= 0)
+            removeSubscriber(i);
+         continue;
+      }
+      is_ring = (strcmp(b, BTN_SUBSCRIBE_RING) == 0);
+      if (!is_ring && strcmp(b, BTN_SUBSCRIBE) != 0) {
+         fprintf(stderr, "Unknown request \"%s\"\n", b);
+         continue;
+      }
+
+      if (i < 0) {
+         if (num_subs == BTN_MAX_SUBSCRIBERS)
+            pruneSubscribers();
+         if (num_subs == BTN_MAX_SUBSCRIBERS) {
+            fprintf(stderr, "Too many subscribers (max %d)\n", BTN_MAX_SUBSCRIBERS);
+            continue;
+         }
+         i = num_subs++;
+         subs[i].addr = addr;
+         subs[i].len = len;
+         subs[i].efd = -1;
+      }
+      if (!is_ring && subs[i].efd >= 0) {
+         close(subs[i].efd);
+         subs[i].efd = -1;
+      }
+      else if (is_ring) {
+         if (ring_fd < 0) {
+            fprintf(stderr, "Ring subscription refused, no ring buffer\n");
+            removeSubscriber(i);
+            continue;
+         }
+         if (subs[i].efd < 0)
+            subs[i].efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+         if (subs[i].efd < 0 || replyRing(i) < 0) {
+            fprintf(stderr, "Ring subscription failed: %s\n", strerror(errno));
+            removeSubscriber(i);
+         }
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    btnEventPublish()
+ *
+ * Description: Publishes a gesture to the subscribers, without
+ *              blocking
+ *
+ * Parameters:  source   - button
+ *              gesture  - detected gesture
+ *              stage    - long press stage, 0 for the other gestures
+ *              duration - time the button was held (ms)
+ *
+ ********************************************************************/
+void btnEventPublish(const char *source, BTN_GESTURE_t gesture, int stage,
+                     uint32_t duration)
+{
+   static const uint64_t one = 1;
+   BTN_EVENT_t ev, *slot;
+   int i;
+
+   if (sock < 0)
+      return;
+
+   memset(&ev, 0, sizeof(ev));
+   ev.time = btnMillis();
+   ev.duration = duration;
+   ev.gesture = gesture;
+   ev.stage = stage;
+   strncpy(ev.source, source, BTN_EVENT_NAME_LEN-1);
+
+   // Ring buffer: the seq of a slot is 0 while it is written, readers
+   // check it before and after copying the event
+   seq++;
+   slot = &ring->slot[seq % BTN_RING_SIZE];
+   __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   memcpy(slot, &ev, sizeof(ev));
+   __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+   __atomic_store_n(&ring->head, seq, __ATOMIC_RELEASE);
+   ev.seq = seq;
+
+   for (i=num_subs-1; i>=0; i--) {
+      if (subs[i].efd >= 0) {
+         if (write(subs[i].efd, &one, sizeof(one)) < 0)
+            fprintf(stderr, "eventfd write failed: %s\n", strerror(errno));
+      }
+      else if (sendto(sock, &ev, sizeof(ev), MSG_DONTWAIT | MSG_NOSIGNAL,
+                      (struct sockaddr *)&subs[i].addr, subs[i].len) < 0) {
+         if (errno == ECONNREFUSED || errno == ENOENT)
+            removeSubscriber(i);
+         else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            fprintf(stderr, "Subscriber busy, event %u dropped\n", seq);
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    btnEventCleanup()
+ *
+ * Description: Removes the subscribers, the socket and the ring buffer
+ *
+ ********************************************************************/
+void btnEventCleanup(void)
+{
+   while (num_subs > 0)
+      removeSubscriber(num_subs-1);
+   if (sock >= 0) {
+      close(sock);
+      unlink(sock_addr.sun_path);
+   }
+   if (ring)
+      munmap(ring, sizeof(BTN_RING_t));
+   if (ring_fd >= 0)
+      close(ring_fd);
+   sock = -1;
+   ring = NULL;
+   ring_fd = -1;
+}
+
+
+/*********************************************************************
+ * Function:    btnEventSubscribe()
+ *
+ * Description: Subscribes to the events of a daemon. Events are either
+ *              received from the returned socket as BTN_EVENT_t
+ *              datagrams, or read from the ring buffer with
+ *              btnRingRead() when the eventfd is readable. The socket
+ *              has to be kept open in both cases, closing it ends the
+ *              subscription.
+ *
+ * Parameters:  path - socket file of the daemon
+ *              ring - NULL for datagrams, else (out) the ring buffer,
+ *                     mapped read only
+ *              efd  - (out) eventfd of a ring subscription
+ *
+ * Return:      socket, -1 on error
+ *
+ ********************************************************************/
+int btnEventSubscribe(const char *path, BTN_RING_t **ring, int *efd)
+{
+   union {
+      struct cmsghdr hdr;
+      char b[CMSG_SPACE(2*sizeof(int))];
+   } ctrl;
+   struct sockaddr_un addr;
+   struct pollfd pfd;
+   struct msghdr msg;
+   struct cmsghdr *cmsg;
+   struct iovec iov;
+   const char *req;
+   char b[32];
+   int fd, fds[2];
+   void *p;
+
+   if (strlen(path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "Socket path too long: %s\n", path);
+      return -1;
+   }
+   fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   if (fd < 0) {
+      fprintf(stderr, "socket() failed: %s\n", strerror(errno));
+      return -1;
+   }
+
+   // Autobind: the daemon needs an address to send to
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (bind(fd, (struct sockaddr *)&addr, sizeof(sa_family_t)) < 0)
+      goto error;
+   strcpy(addr.sun_path, path);
+   if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+      goto error;
+   req = (ring ? BTN_SUBSCRIBE_RING : BTN_SUBSCRIBE);
+   if (send(fd, req, strlen(req), 0) < 0)
+      goto error;
+   if (ring == NULL)
+      return fd;
+
+   pfd.fd = fd;
+   pfd.events = POLLIN;
+   if (poll(&pfd, 1, REPLY_TIMEOUT) != 1) {
+      errno = ETIMEDOUT;
+      goto error;
+   }
+   memset(&msg, 0, sizeof(msg));
+   iov.iov_base = b;
+   iov.iov_len = sizeof(b);
+   msg.msg_iov = &iov;
+   msg.msg_iovlen = 1;
+   msg.msg_control = ctrl.b;
+   msg.msg_controllen = sizeof(ctrl.b);
+   if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) < 0)
+      goto error;
+   cmsg = CMSG_FIRSTHDR(&msg);
+   if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS ||
+       cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+      errno = EPROTO;
+      goto error;
+   }
+   memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+   p = mmap(NULL, sizeof(BTN_RING_t), PROT_READ, MAP_SHARED, fds[0], 0);
+   close(fds[0]);
+   if (p == MAP_FAILED) {
+      close(fds[1]);
+      goto error;
+   }
+   *ring = p;
+   if ((*ring)->magic != BTN_RING_MAGIC || (*ring)->size != BTN_RING_SIZE) {
+      munmap(p, sizeof(BTN_RING_t));
+      close(fds[1]);
+      errno = EPROTO;
+      goto error;
+   }
+   *efd = fds[1];
+   return fd;
+
+error:
+   fprintf(stderr, "Subscribe to %s: %s\n", path, strerror(errno));
+   close(fd);
+   return -1;
+}
+
+/*********************************************************************
+ * Function:    btnRingRead()
+ *
+ * Description: Reads the next event from the ring buffer. Events which
+ *              have been overwritten are skipped, which shows as a gap
+ *              in the sequence numbers.
+ *
+ * Parameters:  ring - ring buffer
+ *              tail - seq of the last event read, ring->head to start
+ *                     with the next event
+ *              ev   - (out) event
+ *
+ * Return:      1 if an event was read, 0 if there is none
+ *
+ ********************************************************************/
+int btnRingRead(const BTN_RING_t *ring, uint32_t *tail, BTN_EVENT_t *ev)
+{
+   const BTN_EVENT_t *slot;
+   uint32_t head, want;
+
+   for (;;) {
+      head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+      if (head == *tail)
+         return 0;
+      if (head - *tail > BTN_RING_SIZE)
+         *tail = head - BTN_RING_SIZE;
+
+      want = *tail + 1;
+      slot = &ring->slot[want % BTN_RING_SIZE];
+      if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != want)
+         continue;      // overwritten meanwhile
+      memcpy(ev, slot, sizeof(BTN_EVENT_t));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == want && ev->seq == want) {
+         *tail = want;
+         return 1;
+      }
+   }
+}
@@ -0,0 +1,96 @@
+/*
+ *  Filename: btn_event.h
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Publishing of button gestures to local subscribers, shared by the
+ *  button daemons and their subscribers. Subscribers receive each
+ *  gesture as a BTN_EVENT_t datagram on a Unix socket, or read it from
+ *  a ring buffer in shared memory, woken up by an eventfd.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef btn_event_h
+#define btn_event_h
+
+#include <stdint.h>
+
+#include "btn_gesture.h"
+
+/* socket of the daemon (Unix datagram socket) */
+#define BTN_EVENT_SOCKET "/run/buttond.sock"
+
+/* group whose members may subscribe (besides root) */
+#define BTN_EVENT_GROUP "buttond"
+
+/* max number of subscribers */
+#define BTN_MAX_SUBSCRIBERS 16
+
+/* requests sent by a subscriber to the daemon socket */
+#define BTN_SUBSCRIBE   "subscribe"      // events as datagrams
+#define BTN_SUBSCRIBE_RING "ring"        // events in the ring buffer, the
+                                         // reply carries its memfd and an
+                                         // eventfd (SCM_RIGHTS)
+#define BTN_UNSUBSCRIBE "unsubscribe"
+
+/* length of the button name in an event */
+#define BTN_EVENT_NAME_LEN 64
+
+/* number of events in the ring buffer (power of 2) */
+#define BTN_RING_SIZE 64
+#define BTN_RING_MAGIC 0x42544e52   // "BTNR"
+
+/* Gesture detected on a button */
+typedef struct {
+   uint64_t time;                   // detection time (ms, CLOCK_MONOTONIC)
+   uint32_t seq;                    // sequence number, starting at 1
+   uint32_t duration;               // time the button was held (ms)
+   uint8_t gesture;                 // BTN_GESTURE_t
+   uint8_t stage;                   // long press stage, 0 for the others
+   uint16_t reserved;
+   char source[BTN_EVENT_NAME_LEN]; // button as configured
+}
+BTN_EVENT_t;
+
+/* Ring buffer in shared memory, written by the daemon only. Event seq
+ * is in slot[seq % BTN_RING_SIZE], head is the seq of the last event.
+ */
+typedef struct {
+   uint32_t magic;
+   uint32_t size;                   // BTN_RING_SIZE
+   uint32_t head;
+   uint32_t reserved;
+   BTN_EVENT_t slot[BTN_RING_SIZE];
+}
+BTN_RING_t;
+
+/* daemon */
+int  btnEventInit(const char *path);
+void btnEventRequest(void);
+void btnEventPublish(const char *source, BTN_GESTURE_t gesture, int stage,
+                     uint32_t duration);
+void btnEventCleanup(void);
+
+/* subscriber */
+int  btnEventSubscribe(const char *path, BTN_RING_t **ring, int *efd);
+int  btnRingRead(const BTN_RING_t *ring, uint32_t *tail, BTN_EVENT_t *ev);
+
+#endif /*btn_event_h*/
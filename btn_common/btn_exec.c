@@ -0,0 +1,367 @@
+/*
+ *  Filename: btn_exec.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Asynchronous execution of button actions, shared by the button
+ *  daemons.
+ *
+ *  The command of an action is split into its arguments once when it
+ *  is configured and started with posix_spawnp(), which uses vfork()
+ *  and does not copy the daemon. A shell is started only for commands
+ *  using shell syntax (quotes, redirections, pipes, variables, ...).
+ *
+ *  Each action runs in at most max_running instances at the same time.
+ *  Events for an action which is already running are queued in a
+ *  bounded queue and started when an instance exits, events which do
+ *  not fit into the queue are dropped. SIGCHLD is received via a
+ *  signalfd, which the event loop watches together with the button
+ *  events and then calls btnExecReap().
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+
+#include "btn_exec.h"
+
+/* characters which need the shell to run a command (assignments
+   NAME=value are detected as first word only, see isAssignment()) */
+#define SHELL_CHARS "|&;<>()$`\\\"'*?[]#~{}\n"
+#define SHELL "/bin/sh"
+
+extern char **environ;
+
+/* running children */
+static struct {
+   pid_t pid;                 // 0 if slot is unused
+   BTN_ACTION_t *action;
+} children[BTN_MAX_CHILDREN];
+
+/* actions waiting to be started (FIFO) */
+static BTN_ACTION_t *queue[BTN_QUEUE_SIZE];
+static int queue_len=0;
+
+static int sfd=-1;
+static sigset_t saved_mask;
+
+
+/*********************************************************************
+ * Function:    spawn()
+ *
+ * Description: Starts an instance of an action
+ *
+ * Parameters:  action - action to start
+ *
+ * Return:      0 on success, -1 if no child slot is free, -2 if the
+ *              action could not be started
+ *
+ ********************************************************************/
+static int spawn(BTN_ACTION_t *action)
+{
+   posix_spawnattr_t attr;
+   sigset_t mask;
+   short flags;
+   pid_t pid;
+   int i, err;
+
+   for (i=0; i<BTN_MAX_CHILDREN && children[i].pid; i++);
+   if (i == BTN_MAX_CHILDREN)
+      return -1;
+
+   // The child starts with the signal mask and dispositions the daemon
+   // had before, not with SIGCHLD blocked for the signalfd
+   posix_spawnattr_init(&attr);
+   sigfillset(&mask);
+   posix_spawnattr_setsigdefault(&attr, &mask);
+   posix_spawnattr_setsigmask(&attr, &saved_mask);
+   flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_USEVFORK
+   flags |= POSIX_SPAWN_USEVFORK;
+#endif
+   posix_spawnattr_setflags(&attr, flags);
+
+   err = posix_spawnp(&pid, action->argv[0], NULL, &attr, action->argv, environ);
+   posix_spawnattr_destroy(&attr);
+   if (err) {
+      fprintf(stderr, "Unable to execute \"%s\": %s\n", action->cmd, strerror(err));
+      return -2;
+   }
+
+   children[i].pid = pid;
+   children[i].action = action;
+   action->running++;
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    isAssignment()
+ *
+ * Description: Checks if a command starts with a shell variable
+ *              assignment (NAME=value as first word). A '=' in the
+ *              arguments (e.g. --opt=value) needs no shell.
+ *
+ * Parameters:  cmd - command
+ *
+ * Return:      1 if the first word is an assignment, 0 otherwise
+ *
+ ********************************************************************/
+static int isAssignment(const char *cmd)
+{
+   cmd += strspn(cmd, " \t");
+   if (!(*cmd == '_' || (*cmd >= 'A' && *cmd <= 'Z') || (*cmd >= 'a' && *cmd <= 'z')))
+      return 0;
+   cmd += strspn(cmd, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_");
+   return (*cmd == '=');
+}
+
+
+/*********************************************************************
+ * Function:    btnActionSet()
+ *
+ * Description: Sets the command of an action and splits it into its
+ *              arguments. Commands using shell syntax are run by the
+ *              shell.
+ *
+ * Parameters:  action - action
+ *              cmd    - command, NULL or empty for none
+ *
+ * Return:      0 on success, -1 if the command is too long or has
+ *              too many arguments
+ *
+ ********************************************************************/
+int btnActionSet(BTN_ACTION_t *action, const char *cmd)
+{
+   char *p;
+   int n=0;
+
+   memset(action, 0, sizeof(BTN_ACTION_t));
+   action->max_running = BTN_MAX_RUNNING;
+   if (cmd == NULL || *cmd == 0)
+      return 0;
+
+   if (strlen(cmd) >= BTN_MAX_CMD_LEN) {
+      fprintf(stderr, "Command too long: \"%s\"\n", cmd);
+      return -1;
+   }
+   strcpy(action->cmd, cmd);
+
+   if (strpbrk(cmd, SHELL_CHARS) || isAssignment(cmd)) {
+      action->argv[0] = SHELL;
+      action->argv[1] = "-c";
+      action->argv[2] = action->cmd;
+      return 0;
+   }
+
+   strcpy(action->args, cmd);
+   for (p=strtok(action->args, " \t"); p; p=strtok(NULL, " \t")) {
+      if (n == BTN_MAX_ARGS) {
+         fprintf(stderr, "Too many arguments: \"%s\"\n", cmd);
+         action->argv[0] = NULL;
+         return -1;
+      }
+      action->argv[n++] = p;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    btnActionMove()
+ *
+ * Description: Moves actions within a table (the areas may overlap).
+ *              The arguments of an action point into its own command
+ *              buffers, they are set to the buffers at the new place.
+ *              Only actions which are not running may be moved.
+ *
+ * Parameters:  dst - new place of the actions
+ *              src - actions
+ *              n   - number of actions
+ *
+ ********************************************************************/
+void btnActionMove(BTN_ACTION_t *dst, BTN_ACTION_t *src, int n)
+{
+   uintptr_t p, from;
+   int i, j;
+
+   memmove(dst, src, n*sizeof(BTN_ACTION_t));
+   for (i=0; i<n; i++) {
+      for (j=0; dst[i].argv[j]; j++) {
+         p = (uintptr_t)dst[i].argv[j];
+         from = (uintptr_t)src[i].args;
+         if (p >= from && p < from+BTN_MAX_CMD_LEN)
+            dst[i].argv[j] = dst[i].args + (p-from);
+         from = (uintptr_t)src[i].cmd;
+         if (p >= from && p < from+BTN_MAX_CMD_LEN)
+            dst[i].argv[j] = dst[i].cmd + (p-from);
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    btnExecInit()
+ *
+ * Description: Blocks SIGCHLD and creates the signalfd receiving it
+ *
+ * Return:      signalfd (non blocking) to be watched for POLLIN by the
+ *              event loop, -1 on error
+ *
+ ********************************************************************/
+int btnExecInit(void)
+{
+   sigset_t mask;
+
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   if (sigprocmask(SIG_BLOCK, &mask, &saved_mask) < 0) {
+      fprintf(stderr, "sigprocmask() failed: %s\n", strerror(errno));
+      return -1;
+   }
+
+   sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+   if (sfd < 0) {
+      fprintf(stderr, "signalfd() failed: %s\n", strerror(errno));
+      sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+      return -1;
+   }
+   return sfd;
+}
+
+/*********************************************************************
+ * Function:    btnExecRun()
+ *
+ * Description: Starts an action, or queues it if it is already running
+ *              max_running times or too many actions are running.
+ *              Does not wait for the action.
+ *
+ * Parameters:  action - action to start
+ *
+ * Return:      0 if the action was started or queued, -1 if it was
+ *              dropped
+ *
+ ********************************************************************/
+int btnExecRun(BTN_ACTION_t *action)
+{
+   if (action->argv[0] == NULL)
+      return -1;
+
+   if (action->running < action->max_running) {
+      switch (spawn(action)) {
+         case 0:  return 0;
+         case -2: return -1;
+      }
+   }
+
+   if (queue_len == BTN_QUEUE_SIZE) {
+      fprintf(stderr, "Action queue full, dropping \"%s\"\n", action->cmd);
+      return -1;
+   }
+   queue[queue_len++] = action;
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    btnExecReap()
+ *
+ * Description: Reaps the exited children and starts the queued actions
+ *              which can run now. To be called when the signalfd is
+ *              readable.
+ *
+ ********************************************************************/
+void btnExecReap(void)
+{
+   struct signalfd_siginfo si;
+   pid_t pid;
+   int status;
+   int i, n;
+
+   // Drain the signalfd, several exits may be reported by one signal
+   while (read(sfd, &si, sizeof(si)) == sizeof(si));
+
+   while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      for (i=0; i<BTN_MAX_CHILDREN && children[i].pid != pid; i++);
+      if (i == BTN_MAX_CHILDREN)
+         continue;
+
+      children[i].pid = 0;
+      if (children[i].action == NULL)
+         continue;      // detached by btnExecDetach()
+
+      if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+         fprintf(stderr, "Command \"%s\" exited with status %d\n",
+                 children[i].action->cmd, WEXITSTATUS(status));
+      else if (WIFSIGNALED(status))
+         fprintf(stderr, "Command \"%s\" killed by signal %d\n",
+                 children[i].action->cmd, WTERMSIG(status));
+      children[i].action->running--;
+   }
+
+   // Start queued actions in FIFO order, keep the ones still waiting
+   for (i=0, n=0; i<queue_len; i++) {
+      if (queue[i]->running >= queue[i]->max_running || spawn(queue[i]) == -1)
+         queue[n++] = queue[i];
+   }
+   queue_len = n;
+}
+
+/*********************************************************************
+ * Function:    btnExecDetach()
+ *
+ * Description: Detaches the running instances from their actions and
+ *              drops the queued actions, before the actions are
+ *              replaced by a new configuration. The running instances
+ *              are still reaped, but no longer count for max_running.
+ *
+ ********************************************************************/
+void btnExecDetach(void)
+{
+   int i;
+
+   for (i=0; i<BTN_MAX_CHILDREN; i++)
+      children[i].action = NULL;
+   if (queue_len)
+      fprintf(stderr, "%d queued commands dropped\n", queue_len);
+   queue_len = 0;
+}
+
+/*********************************************************************
+ * Function:    btnExecCleanup()
+ *
+ * Description: Closes the signalfd and restores the signal mask.
+ *              Running actions are not waited for.
+ *
+ ********************************************************************/
+void btnExecCleanup(void)
+{
+   if (sfd >= 0) {
+      close(sfd);
+      sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+   }
+   sfd = -1;
+   queue_len = 0;
+}
@@ -0,0 +1,67 @@
+/*
+ *  Filename: btn_exec.h
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Asynchronous execution of button actions, shared by the button
+ *  daemons. Actions are started with posix_spawn() without blocking
+ *  the event loop, their children are reaped via a signalfd which is
+ *  watched by the event loop together with the button events.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef btn_exec_h
+#define btn_exec_h
+
+#include <stdint.h>
+
+/* max length of a command and max number of its arguments */
+#define BTN_MAX_CMD_LEN 256
+#define BTN_MAX_ARGS 16
+
+/* max number of actions running at the same time and of actions
+ * waiting to be started
+ */
+#define BTN_MAX_CHILDREN 8
+#define BTN_QUEUE_SIZE 16
+
+/* default number of instances of an action running at the same time */
+#define BTN_MAX_RUNNING 1
+
+/* Command executed on a button event */
+typedef struct {
+   char cmd[BTN_MAX_CMD_LEN];       // command as configured
+   char args[BTN_MAX_CMD_LEN];      // storage of the split arguments
+   char *argv[BTN_MAX_ARGS+1];      // arguments, argv[0] NULL if no command
+   uint8_t max_running;             // max instances running at the same time
+   uint8_t running;                 // instances running
+}
+BTN_ACTION_t;
+
+int  btnActionSet(BTN_ACTION_t *action, const char *cmd);
+void btnActionMove(BTN_ACTION_t *dst, BTN_ACTION_t *src, int n);
+int  btnExecInit(void);
+int  btnExecRun(BTN_ACTION_t *action);
+void btnExecReap(void);
+void btnExecDetach(void);
+void btnExecCleanup(void);
+
+#endif /*btn_exec_h*/
@@ -0,0 +1,354 @@
+/*
+ *  Filename: btn_gesture.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Gesture engine shared by the button daemons.
+ *
+ *  The daemons pass the press and release events of their buttons
+ *  with a monotonic timestamp in ms to btnGestureEdge(). Pending
+ *  timeouts (long press stages, end of the double click time) of all
+ *  buttons are served by one timerfd, armed for the earliest of them,
+ *  which the event loop watches together with the button events and
+ *  then calls btnGestureTimer(). So a long press is reported the
+ *  moment its threshold is reached while the button is still held,
+ *  and everything runs in the single threaded event loop.
+ *
+ *  Gestures:
+ *  - short:  released before the first long press stage. If a double
+ *            click time is set, it is reported only when no second
+ *            press follows within that time.
+ *  - double: second short press starting within the double click time
+ *            after the first one was released
+ *  - long:   one event per stage when its threshold is reached
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "btn_gesture.h"
+
+static BTN_INPUT_t *inputs[BTN_MAX_INPUTS];
+static int num_inputs=0;
+static BTN_GESTURE_HANDLER_t gesture_handler;
+static int tfd=-1;
+static uint64_t armed;        // deadline the timerfd is armed for
+
+
+/*********************************************************************
+ * Function:    arm()
+ *
+ * Description: Arms the timerfd for the earliest deadline of all
+ *              inputs
+ *
+ ********************************************************************/
+static void arm(void)
+{
+   struct itimerspec its;
+   uint64_t deadline = 0;
+   int i;
+
+   for (i=0; i<num_inputs; i++) {
+      if (inputs[i]->deadline && (deadline == 0 || inputs[i]->deadline < deadline))
+         deadline = inputs[i]->deadline;
+   }
+   if (deadline == armed)
+      return;
+
+   // absolute time, all zero disarms the timer
+   memset(&its, 0, sizeof(its));
+   its.it_value.tv_sec = deadline / 1000;
+   its.it_value.tv_nsec = (deadline % 1000) * 1000000;
+   if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0)
+      fprintf(stderr, "timerfd_settime() failed: %s\n", strerror(errno));
+   armed = deadline;
+}
+
+/*********************************************************************
+ * Function:    long_press()
+ *
+ * Description: Reports the long press stages reached at the given
+ *              time and sets the deadline of the next one
+ *
+ ********************************************************************/
+static void long_press(BTN_INPUT_t *input, uint64_t time)
+{
+   while (input->stage < input->num_stages &&
+          time - input->press_time >= input->long_press[input->stage]) {
+      if (input->clicks) {
+         // the first click of the double click was a short press
+         gesture_handler(input, GESTURE_SHORT, 0, input->click_duration);
+         input->clicks = 0;
+      }
+      input->stage++;
+      gesture_handler(input, GESTURE_LONG, input->stage,
+                      input->long_press[input->stage-1]);
+   }
+   input->deadline = (input->stage < input->num_stages ?
+                      input->press_time + input->long_press[input->stage] : 0);
+}
+
+
+/*********************************************************************
+ * Function:    btnMillis()
+ *
+ * Description: Reads the current monotonic time in ms
+ *
+ ********************************************************************/
+uint64_t btnMillis(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*********************************************************************
+ * Function:    btnGestureInit()
+ *
+ * Description: Initializes the gesture engine
+ *
+ * Parameters:  handler - function called for each detected gesture
+ *
+ * Return:      timerfd (non blocking) to be watched for POLLIN by the
+ *              event loop, -1 on error
+ *
+ ********************************************************************/
+int btnGestureInit(BTN_GESTURE_HANDLER_t handler)
+{
+   gesture_handler = handler;
+   num_inputs = 0;
+   armed = 0;
+
+   tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   if (tfd < 0)
+      fprintf(stderr, "timerfd_create() failed: %s\n", strerror(errno));
+   return tfd;
+}
+
+/*********************************************************************
+ * Function:    btnGestureAdd()
+ *
+ * Description: Adds an input with its configuration set (long press
+ *              stages in ascending order)
+ *
+ * Parameters:  input - input
+ *
+ * Return:      0 on success, -1 if too many inputs
+ *
+ ********************************************************************/
+int btnGestureAdd(BTN_INPUT_t *input)
+{
+   if (num_inputs == BTN_MAX_INPUTS) {
+      fprintf(stderr, "Too many inputs (max %d)\n", BTN_MAX_INPUTS);
+      return -1;
+   }
+
+   input->pressed = 0;
+   input->stage = 0;
+   input->clicks = 0;
+   input->deadline = 0;
+   inputs[num_inputs++] = input;
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    btnGestureEdge()
+ *
+ * Description: Handles a press or release of a button
+ *
+ * Parameters:  input   - input
+ *              pressed - 1 if the button was pressed, 0 if released
+ *              time    - time of the event (ms, CLOCK_MONOTONIC)
+ *
+ ********************************************************************/
+void btnGestureEdge(BTN_INPUT_t *input, int pressed, uint64_t time)
+{
+   uint32_t duration;
+
+   if (pressed == input->pressed)
+      return;
+   input->pressed = pressed;
+
+   if (pressed) {
+      input->press_time = time;
+      input->stage = 0;
+      if (input->clicks && time - input->release_time > input->double_click) {
+         // timer not yet served, the first press was a short one
+         gesture_handler(input, GESTURE_SHORT, 0, input->click_duration);
+         input->clicks = 0;
+      }
+      input->deadline = (input->num_stages ? time + input->long_press[0] : 0);
+   }
+   else {
+      duration = time - input->press_time;
+      // stages reached but not yet served by the timer
+      long_press(input, time);
+      input->deadline = 0;
+
+      if (input->stage) {
+         // long press, already reported
+         input->clicks = 0;
+      }
+      else if (input->clicks) {
+         input->clicks = 0;
+         gesture_handler(input, GESTURE_DOUBLE, 0, duration);
+      }
+      else if (input->double_click) {
+         // wait for a second press
+         input->clicks = 1;
+         input->click_duration = duration;
+         input->release_time = time;
+         input->deadline = time + input->double_click;
+      }
+      else
+         gesture_handler(input, GESTURE_SHORT, 0, duration);
+   }
+   arm();
+}
+
+/*********************************************************************
+ * Function:    btnGestureReset()
+ *
+ * Description: Drops the current press and pending gestures of an
+ *              input without reporting them, e.g. when the device of
+ *              a held button is removed
+ *
+ * Parameters:  input - input
+ *
+ ********************************************************************/
+void btnGestureReset(BTN_INPUT_t *input)
+{
+   input->pressed = 0;
+   input->stage = 0;
+   input->clicks = 0;
+   input->deadline = 0;
+   arm();
+}
+
+/*********************************************************************
+ * Function:    btnGestureClear()
+ *
+ * Description: Removes all inputs, e.g. before they are replaced by a
+ *              new configuration. The timerfd is kept.
+ *
+ ********************************************************************/
+void btnGestureClear(void)
+{
+   num_inputs = 0;
+   arm();
+}
+
+/*********************************************************************
+ * Function:    btnGestureTransfer()
+ *
+ * Description: Continues the press in progress or the pending short
+ *              press of an input on its replacement, which has been
+ *              added with the new configuration. Long press stages
+ *              whose new threshold has already passed are not
+ *              reported any more, a short press waiting for a double
+ *              click which is no longer configured is reported at once.
+ *
+ * Parameters:  input - new input
+ *              old   - copy of the old input
+ *
+ ********************************************************************/
+void btnGestureTransfer(BTN_INPUT_t *input, const BTN_INPUT_t *old)
+{
+   uint64_t now = btnMillis();
+
+   input->pressed = old->pressed;
+   input->press_time = old->press_time;
+   input->clicks = old->clicks;
+   input->click_duration = old->click_duration;
+   input->release_time = old->release_time;
+   input->stage = 0;
+   input->deadline = 0;
+
+   if (input->clicks && input->double_click == 0) {
+      input->clicks = 0;
+      gesture_handler(input, GESTURE_SHORT, 0, input->click_duration);
+   }
+
+   if (input->pressed) {
+      while (input->stage < input->num_stages &&
+             now - input->press_time >= input->long_press[input->stage])
+         input->stage++;
+      input->deadline = (input->stage < input->num_stages ?
+                         input->press_time + input->long_press[input->stage] : 0);
+   }
+   else if (input->clicks)
+      input->deadline = input->release_time + input->double_click;
+   arm();
+}
+
+/*********************************************************************
+ * Function:    btnGestureTimer()
+ *
+ * Description: Handles the expired timeouts. To be called when the
+ *              timerfd is readable.
+ *
+ ********************************************************************/
+void btnGestureTimer(void)
+{
+   BTN_INPUT_t *input;
+   uint64_t expirations;
+   uint64_t now = btnMillis();
+   int i;
+
+   if (read(tfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+      fprintf(stderr, "Unable to read timerfd: %s\n", strerror(errno));
+   armed = 0;
+
+   for (i=0; i<num_inputs; i++) {
+      input = inputs[i];
+      if (input->deadline == 0 || input->deadline > now)
+         continue;
+
+      if (input->pressed)
+         long_press(input, now);
+      else {
+         // no second press within the double click time
+         input->clicks = 0;
+         input->deadline = 0;
+         gesture_handler(input, GESTURE_SHORT, 0, input->click_duration);
+      }
+   }
+   arm();
+}
+
+/*********************************************************************
+ * Function:    btnGestureCleanup()
+ *
+ * Description: Closes the timerfd and removes all inputs
+ *
+ ********************************************************************/
+void btnGestureCleanup(void)
+{
+   if (tfd >= 0) close(tfd);
+   tfd = -1;
+   num_inputs = 0;
+}
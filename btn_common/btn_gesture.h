@@ -0,0 +1,85 @@
+/*
+ *  Filename: btn_gesture.h
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Gesture engine shared by the button daemons: classifies the press
+ *  and release events of buttons into short presses, double clicks
+ *  and (multi-stage) long presses.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef btn_gesture_h
+#define btn_gesture_h
+
+#include <stdint.h>
+
+/* max number of inputs and of long press stages per input */
+#define BTN_MAX_INPUTS 64
+#define BTN_MAX_STAGES 4
+
+/* default double click time (ms) */
+#define BTN_DOUBLE_CLICK 400
+
+typedef enum {
+   GESTURE_SHORT,      // released before the first long press stage
+   GESTURE_DOUBLE,     // two short presses within the double click time
+   GESTURE_LONG        // held until a long press stage (fired at once)
+}
+BTN_GESTURE_t;
+
+/* Gesture state of a button */
+typedef struct {
+   // configuration
+   uint32_t long_press[BTN_MAX_STAGES];  // stage thresholds (ms), ascending
+   uint8_t num_stages;
+   uint32_t double_click;    // max time from release to next press (ms),
+                             // 0: short presses are reported at once
+   void *ctx;                // passed to the gesture handler
+   // state
+   uint8_t pressed;
+   uint8_t stage;            // long press stages reported
+   uint8_t clicks;           // short presses waiting for a double click
+   uint64_t press_time;      // ms, monotonic
+   uint64_t release_time;
+   uint32_t click_duration;  // duration of the waiting short press
+   uint64_t deadline;        // next timeout (ms), 0 if none
+}
+BTN_INPUT_t;
+
+/* Called for each detected gesture. stage is the long press stage
+ * (1..num_stages), 0 for the other gestures. duration is the time the
+ * button was held (ms).
+ */
+typedef void (*BTN_GESTURE_HANDLER_t)(BTN_INPUT_t *input, BTN_GESTURE_t gesture,
+                                      int stage, uint32_t duration);
+
+uint64_t btnMillis(void);
+int  btnGestureInit(BTN_GESTURE_HANDLER_t handler);
+int  btnGestureAdd(BTN_INPUT_t *input);
+void btnGestureEdge(BTN_INPUT_t *input, int pressed, uint64_t time);
+void btnGestureReset(BTN_INPUT_t *input);
+void btnGestureClear(void);
+void btnGestureTransfer(BTN_INPUT_t *input, const BTN_INPUT_t *old);
+void btnGestureTimer(void);
+void btnGestureCleanup(void);
+
+#endif /*btn_gesture_h*/
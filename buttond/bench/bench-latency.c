@@ -0,0 +1,620 @@
+/************************************************************************
+  bench-latency - Press-to-action latency of the button daemon
+
+  Runs buttond with one button whose action is a probe (this program
+  started with --probe), injects synthetic button presses and measures
+  the time from the edge to the start of the probe, which writes its
+  start time to a FIFO. Presses are injected through:
+
+  - uinput:   a virtual input device with BTN_1 (evdev source)
+  - gpiochip: a gpio-sim line pulled up and down through its pull
+              attribute (GPIO character device source)
+  - sysfs:    the same line used by its kernel GPIO number
+
+  For short presses the latency is measured from the release, for long
+  presses from the time the long press threshold is reached. With
+  --shell the probe is started through the shell, as any command using
+  shell syntax is, instead of being spawned directly. Background load
+  is generated by busy looping processes.
+
+  Reports the latency percentiles, the lost presses and the CPU time
+  and memory (RSS) of the daemon.
+
+  gpio-sim lines are set up with ../../dhtlib/bench/gpio-sim.sh, whose
+  --chip, --line, --toggle and --pin options are used here as well.
+
+  The probe command is checked with btnActionSet() of the daemon
+  (../../btn_common/btn_exec.c), so the direct probe is really started
+  without the shell.
+
+  Author: Ondrej Wisniewski
+
+  Build command:
+  make bench-latency
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+#include "btn_exec.h"
+
+#define DEFAULT_DAEMON   "../buttond"
+#define DEFAULT_PRESSES  200
+#define DEFAULT_INTERVAL 100    // ms between presses
+#define DEFAULT_HOLD     20     // ms a short press is held
+#define DEFAULT_STARTUP  500    // ms for the daemon to set up
+#define LONG_PRESS       500    // ms threshold of the long press
+#define PROBE_TIMEOUT    2000   // ms
+#define MAX_LOAD         64
+
+typedef enum {
+   SRC_UINPUT,
+   SRC_GPIOCHIP,
+   SRC_SYSFS
+}
+SOURCE_t;
+
+/* Benchmark configuration */
+static struct {
+   const char *daemon;     // buttond executable
+   SOURCE_t source;
+   const char *chip;       // GPIO chip device
+   int line;               // line offset on the chip
+   int pin;                // kernel GPIO number for sysfs
+   const char *toggle;     // gpio-sim pull attribute of the line
+   int presses;
+   int interval;
+   int hold;
+   int startup;
+   int load;               // busy looping processes
+   int is_long;            // long press instead of short press
+   int shell;              // start the probe through the shell
+} cfg = {
+   .daemon   = DEFAULT_DAEMON,
+   .line     = -1,
+   .pin      = -1,
+   .presses  = DEFAULT_PRESSES,
+   .interval = DEFAULT_INTERVAL,
+   .hold     = DEFAULT_HOLD,
+   .startup  = DEFAULT_STARTUP
+};
+
+static char dir[64];            // temporary directory
+static char fifo[96];           // probe FIFO
+static int uinput_fd = -1;
+static int toggle_fd = -1;
+static pid_t daemon_pid = 0;
+static pid_t load_pid[MAX_LOAD];
+
+
+/*********************************************************************
+ * Function:    nanos()
+ *
+ * Description: Reads the current monotonic time in ns
+ *
+ ********************************************************************/
+static uint64_t nanos(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static void sleep_ms(int ms)
+{
+   struct timespec ts = { ms/1000, (ms%1000)*1000000 };
+   while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+/*********************************************************************
+ * Function:    probe()
+ *
+ * Description: Probe action: writes its start time to the FIFO
+ *
+ ********************************************************************/
+static int probe(const char *path)
+{
+   char b[32];
+   uint64_t now = nanos();
+   int fd, n;
+
+   fd = open(path, O_WRONLY | O_NONBLOCK);
+   if (fd < 0)
+      return 1;
+   n = snprintf(b, sizeof(b), "%llu\n", (unsigned long long)now);
+   n = (write(fd, b, n) == n ? 0 : 1);
+   close(fd);
+   return n;
+}
+
+
+/*********************************************************************
+ * Function:    setup_uinput()
+ *
+ * Description: Creates a virtual input device with BTN_1
+ *
+ * Parameters:  dev (out) : its event device in /dev/input
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int setup_uinput(char *dev, int len)
+{
+   struct uinput_user_dev udev;
+   char sysname[32], path[96];
+   struct dirent *d;
+   DIR *dp;
+   int i;
+
+   uinput_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+   if (uinput_fd < 0) {
+      fprintf(stderr, "Open /dev/uinput: %s\n", strerror(errno));
+      return -1;
+   }
+   memset(&udev, 0, sizeof(udev));
+   strcpy(udev.name, "bench-latency");
+   udev.id.bustype = BUS_VIRTUAL;
+   if (ioctl(uinput_fd, UI_SET_EVBIT, EV_KEY) < 0 ||
+       ioctl(uinput_fd, UI_SET_KEYBIT, BTN_1) < 0 ||
+       write(uinput_fd, &udev, sizeof(udev)) != sizeof(udev) ||
+       ioctl(uinput_fd, UI_DEV_CREATE) < 0) {
+      fprintf(stderr, "Unable to create uinput device: %s\n", strerror(errno));
+      return -1;
+   }
+
+   // Event device of the new input device (node created by devtmpfs)
+   if (ioctl(uinput_fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+      fprintf(stderr, "UI_GET_SYSNAME failed: %s\n", strerror(errno));
+      return -1;
+   }
+   snprintf(path, sizeof(path), "/sys/devices/virtual/input/%s", sysname);
+   dev[0] = 0;
+   for (i=0; i<100 && dev[0] == 0; i++) {
+      dp = opendir(path);
+      while (dp && (d = readdir(dp)) != NULL) {
+         if (strncmp(d->d_name, "event", 5) == 0)
+            snprintf(dev, len, "/dev/input/%.32s", d->d_name);
+      }
+      if (dp) closedir(dp);
+      if (dev[0] == 0 || access(dev, R_OK) != 0) {
+         dev[0] = 0;
+         sleep_ms(10);
+      }
+   }
+   if (dev[0] == 0) {
+      fprintf(stderr, "No event device for %s\n", path);
+      return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    press()
+ *
+ * Description: Presses (1) or releases (0) the button
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int press(int pressed)
+{
+   struct input_event ev[2];
+   const char *pull;
+
+   if (cfg.source == SRC_UINPUT) {
+      memset(ev, 0, sizeof(ev));
+      ev[0].type = EV_KEY;
+      ev[0].code = BTN_1;
+      ev[0].value = pressed;
+      ev[1].type = EV_SYN;
+      ev[1].code = SYN_REPORT;
+      return (write(uinput_fd, ev, sizeof(ev)) == sizeof(ev) ? 0 : -1);
+   }
+
+   // pressed button pulls the line low
+   pull = (pressed ? "pull-down" : "pull-up");
+   return (pwrite(toggle_fd, pull, strlen(pull), 0) >= 0 ? 0 : -1);
+}
+
+
+/*********************************************************************
+ * Function:    start_daemon()
+ *
+ * Description: Writes the configuration and starts the daemon, its
+ *              output goes to a log file
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int start_daemon(const char *button)
+{
+   char config[96], log[96], self[256], cmd[BTN_MAX_CMD_LEN];
+   BTN_ACTION_t action;
+   FILE *f;
+   int n, fd;
+
+   n = readlink("/proc/self/exe", self, sizeof(self)-1);
+   if (n < 0) {
+      fprintf(stderr, "readlink /proc/self/exe: %s\n", strerror(errno));
+      return -1;
+   }
+   self[n] = 0;
+
+   // The FIFO is a separate argument, the direct probe command must not
+   // contain any shell syntax
+   n = snprintf(cmd, sizeof(cmd), "%s --probe %s%s", self, fifo,
+                cfg.shell ? " >/dev/null" : "");
+   // Check that the daemon starts the probe as requested
+   if (n >= (int)sizeof(cmd) || btnActionSet(&action, cmd) < 0) {
+      fprintf(stderr, "Probe command too long: %s\n", self);
+      return -1;
+   }
+   if ((strcmp(action.argv[0], "/bin/sh") == 0) != cfg.shell) {
+      fprintf(stderr, "Probe \"%s\" would %sbe started through the shell\n",
+              cmd, cfg.shell ? "not " : "");
+      return -1;
+   }
+
+   snprintf(config, sizeof(config), "%s/buttond.conf", dir);
+   f = fopen(config, "w");
+   if (f == NULL) {
+      fprintf(stderr, "Open %s: %s\n", config, strerror(errno));
+      return -1;
+   }
+   if (cfg.is_long)
+      fprintf(f, "%s long:%d %s\n", button, LONG_PRESS, cmd);
+   else
+      fprintf(f, "%s short %s\n", button, cmd);
+   fclose(f);
+
+   snprintf(log, sizeof(log), "%s/buttond.log", dir);
+   daemon_pid = fork();
+   if (daemon_pid < 0) {
+      fprintf(stderr, "fork() failed: %s\n", strerror(errno));
+      return -1;
+   }
+   if (daemon_pid == 0) {
+      fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0) {
+         dup2(fd, 1);
+         dup2(fd, 2);
+      }
+      execl(cfg.daemon, cfg.daemon, "-c", config, (char *)NULL);
+      fprintf(stderr, "Unable to execute %s: %s\n", cfg.daemon, strerror(errno));
+      _exit(127);
+   }
+
+   sleep_ms(cfg.startup);
+   if (waitpid(daemon_pid, NULL, WNOHANG) != 0) {
+      fprintf(stderr, "%s exited, see %s\n", cfg.daemon, log);
+      daemon_pid = 0;
+      return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    daemon_usage()
+ *
+ * Description: Reads the CPU time (user + system, ms) and the current
+ *              and peak RSS (kB) of the daemon
+ *
+ ********************************************************************/
+static void daemon_usage(double *cpu, long *rss, long *hwm)
+{
+   char b[1024], *p;
+   unsigned long utime, stime;
+   FILE *f;
+
+   *cpu = 0;
+   *rss = *hwm = 0;
+   snprintf(b, sizeof(b), "/proc/%d/stat", (int)daemon_pid);
+   f = fopen(b, "r");
+   if (f) {
+      // fields after the command name: state is field 3, utime 14, stime 15
+      if (fgets(b, sizeof(b), f) && (p = strrchr(b, ')')) != NULL &&
+          sscanf(p+2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                 &utime, &stime) == 2)
+         *cpu = (utime + stime) * 1000.0 / sysconf(_SC_CLK_TCK);
+      fclose(f);
+   }
+
+   snprintf(b, sizeof(b), "/proc/%d/status", (int)daemon_pid);
+   f = fopen(b, "r");
+   if (f) {
+      while (fgets(b, sizeof(b), f)) {
+         sscanf(b, "VmRSS: %ld", rss);
+         sscanf(b, "VmHWM: %ld", hwm);
+      }
+      fclose(f);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    start_load()
+ *
+ * Description: Starts the busy looping background processes
+ *
+ ********************************************************************/
+static void start_load(void)
+{
+   volatile unsigned long n = 0;
+   int i;
+
+   for (i=0; i<cfg.load; i++) {
+      load_pid[i] = fork();
+      if (load_pid[i] == 0) {
+         for (;;)
+            n++;
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    cleanup()
+ *
+ * Description: Stops the processes and removes the injector and the
+ *              temporary files
+ *
+ ********************************************************************/
+static void cleanup(void)
+{
+   char b[128];
+   int i;
+
+   for (i=0; i<cfg.load; i++) {
+      if (load_pid[i] > 0) {
+         kill(load_pid[i], SIGKILL);
+         waitpid(load_pid[i], NULL, 0);
+      }
+   }
+   if (daemon_pid > 0) {
+      kill(daemon_pid, SIGTERM);
+      waitpid(daemon_pid, NULL, 0);
+   }
+   if (uinput_fd >= 0) {
+      ioctl(uinput_fd, UI_DEV_DESTROY);
+      close(uinput_fd);
+   }
+   if (toggle_fd >= 0)
+      close(toggle_fd);
+   if (dir[0]) {
+      unlink(fifo);
+      snprintf(b, sizeof(b), "%s/buttond.conf", dir);
+      unlink(b);
+      snprintf(b, sizeof(b), "%s/buttond.log", dir);
+      unlink(b);
+      rmdir(dir);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    run()
+ *
+ * Description: Injects the presses and waits for the probe of each
+ *
+ * Parameters:  latency (out) : latency of each press (us)
+ *
+ * Return:      number of presses with probe
+ *
+ ********************************************************************/
+static int run(int fifo_fd, uint32_t *latency)
+{
+   struct pollfd pfd = { .fd = fifo_fd, .events = POLLIN };
+   char b[64];
+   uint64_t t0, t;
+   int i, n, ok = 0;
+
+   for (i=0; i<cfg.presses; i++) {
+      if (press(1) < 0) {
+         fprintf(stderr, "Unable to press the button: %s\n", strerror(errno));
+         break;
+      }
+      if (cfg.is_long)
+         t0 = nanos() + (uint64_t)LONG_PRESS*1000000;
+      else {
+         sleep_ms(cfg.hold);
+         t0 = nanos();
+         press(0);
+      }
+
+      n = 0;
+      if (poll(&pfd, 1, PROBE_TIMEOUT + (cfg.is_long ? LONG_PRESS : 0)) > 0)
+         n = read(fifo_fd, b, sizeof(b)-1);
+      if (cfg.is_long)
+         press(0);
+      if (n > 0) {
+         b[n] = 0;
+         t = strtoull(b, NULL, 10);
+         latency[ok++] = (t > t0 ? (t - t0)/1000 : 0);
+      }
+      else
+         fprintf(stderr, "Press %d: no action\n", i+1);
+
+      sleep_ms(cfg.interval);
+   }
+   return ok;
+}
+
+/*********************************************************************
+ * Function:    compare()
+ *
+ * Description: qsort() comparison of latencies
+ *
+ ********************************************************************/
+static int compare(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("bench-latency - press-to-action latency of the button daemon\n\n");
+   printf("Usage: bench-latency --source=uinput|gpiochip|sysfs [options]\n");
+   printf("Options:\n");
+   printf("       --daemon=<file>     buttond executable (default: %s)\n", DEFAULT_DAEMON);
+   printf("       --chip=<dev>        GPIO chip of the gpio-sim line (gpiochip source)\n");
+   printf("       --line=<n>          line offset on the chip (gpiochip source)\n");
+   printf("       --pin=<n>           kernel GPIO number of the line (sysfs source)\n");
+   printf("       --toggle=<file>     gpio-sim pull attribute of the line (gpio sources)\n");
+   printf("       --presses=<n>       number of presses (default: %d)\n", DEFAULT_PRESSES);
+   printf("       --interval=<ms>     time between presses (default: %d)\n", DEFAULT_INTERVAL);
+   printf("       --hold=<ms>         duration of a short press (default: %d)\n", DEFAULT_HOLD);
+   printf("       --startup=<ms>      time for the daemon to start (default: %d)\n", DEFAULT_STARTUP);
+   printf("       --load=<n>          busy looping background processes (default: 0)\n");
+   printf("       --long              long press (%d ms) instead of short press\n", LONG_PRESS);
+   printf("       --shell             start the probe through the shell\n");
+   printf("gpio-sim options: see ../../dhtlib/bench/gpio-sim.sh\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   static const struct option options[] = {
+      { "source",   required_argument, NULL, 's' },
+      { "daemon",   required_argument, NULL, 'd' },
+      { "chip",     required_argument, NULL, 'c' },
+      { "line",     required_argument, NULL, 'l' },
+      { "pin",      required_argument, NULL, 'p' },
+      { "toggle",   required_argument, NULL, 't' },
+      { "presses",  required_argument, NULL, 'n' },
+      { "interval", required_argument, NULL, 'i' },
+      { "hold",     required_argument, NULL, 'H' },
+      { "startup",  required_argument, NULL, 'S' },
+      { "load",     required_argument, NULL, 'L' },
+      { "long",     no_argument,       NULL, 'g' },
+      { "shell",    no_argument,       NULL, 'x' },
+      { "probe",    required_argument, NULL, 'P' },
+      { "help",     no_argument,       NULL, 'h' },
+      { NULL, 0, NULL, 0 }
+   };
+   char button[96];
+   uint32_t *latency;
+   double cpu0, cpu1;
+   long rss, hwm;
+   uint64_t start, wall;
+   int opt, n, fifo_fd, ret = -1;
+   int source = -1;
+
+   while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+   {
+      switch (opt)
+      {
+         case 'P': return probe(optarg);
+         case 's':
+            source = (strcmp(optarg, "uinput") == 0 ? SRC_UINPUT :
+                      strcmp(optarg, "gpiochip") == 0 ? SRC_GPIOCHIP :
+                      strcmp(optarg, "sysfs") == 0 ? SRC_SYSFS : -1);
+            break;
+         case 'd': cfg.daemon = optarg; break;
+         case 'c': cfg.chip = optarg; break;
+         case 'l': cfg.line = atoi(optarg); break;
+         case 'p': cfg.pin = atoi(optarg); break;
+         case 't': cfg.toggle = optarg; break;
+         case 'n': cfg.presses = atoi(optarg); break;
+         case 'i': cfg.interval = atoi(optarg); break;
+         case 'H': cfg.hold = atoi(optarg); break;
+         case 'S': cfg.startup = atoi(optarg); break;
+         case 'L': cfg.load = atoi(optarg); break;
+         case 'g': cfg.is_long = 1; break;
+         case 'x': cfg.shell = 1; break;
+         default:
+            usage();
+            return -1;
+      }
+   }
+   cfg.source = source;
+   if (source < 0 || cfg.presses <= 0 || cfg.load < 0 || cfg.load > MAX_LOAD ||
+       (source == SRC_GPIOCHIP && (cfg.chip == NULL || cfg.line < 0 || cfg.toggle == NULL)) ||
+       (source == SRC_SYSFS && (cfg.pin <= 0 || cfg.toggle == NULL))) {
+      usage();
+      return -1;
+   }
+
+   latency = malloc(sizeof(uint32_t) * cfg.presses);
+   strcpy(dir, "/tmp/bench-latency.XXXXXX");
+   if (latency == NULL || mkdtemp(dir) == NULL) {
+      fprintf(stderr, "Unable to set up: %s\n", strerror(errno));
+      dir[0] = 0;
+      return -1;
+   }
+   snprintf(fifo, sizeof(fifo), "%s/probe", dir);
+   // O_RDWR: neither the open blocks nor the read returns EOF between probes
+   if (mkfifo(fifo, 0600) < 0 || (fifo_fd = open(fifo, O_RDWR | O_NONBLOCK)) < 0) {
+      fprintf(stderr, "Unable to create %s: %s\n", fifo, strerror(errno));
+      goto exit;
+   }
+
+   // Injector, button released
+   if (source == SRC_UINPUT) {
+      if (setup_uinput(button, sizeof(button)) < 0)
+         goto exit;
+      strcat(button, ":BTN_1");
+   }
+   else {
+      toggle_fd = open(cfg.toggle, O_WRONLY);
+      if (toggle_fd < 0 || press(0) < 0) {
+         fprintf(stderr, "Unable to write %s: %s\n", cfg.toggle, strerror(errno));
+         goto exit;
+      }
+      if (source == SRC_GPIOCHIP)
+         snprintf(button, sizeof(button), "%s:%d", cfg.chip, cfg.line);
+      else
+         snprintf(button, sizeof(button), "%d", cfg.pin);
+   }
+
+   if (start_daemon(button) < 0)
+      goto exit;
+   start_load();
+
+   daemon_usage(&cpu0, &rss, &hwm);
+   start = nanos();
+   n = run(fifo_fd, latency);
+   wall = nanos() - start;
+   daemon_usage(&cpu1, &rss, &hwm);
+
+   printf("source %s, %s press, %s probe, %d load processes\n",
+          source == SRC_UINPUT ? "uinput" : source == SRC_GPIOCHIP ? "gpiochip" : "sysfs",
+          cfg.is_long ? "long" : "short", cfg.shell ? "shell" : "direct", cfg.load);
+   printf("presses  lost  p50 (us)  p90 (us)  p99 (us)  max (us)  daemon cpu (ms)  cpu%%  rss (kB)  peak rss (kB)\n");
+   if (n > 0) {
+      qsort(latency, n, sizeof(uint32_t), compare);
+      printf("%7d %5d %9u %9u %9u %9u %16.1f %5.2f %9ld %14ld\n",
+             cfg.presses, cfg.presses - n,
+             latency[n/2], latency[n*9/10], latency[n*99/100], latency[n-1],
+             cpu1 - cpu0, (cpu1 - cpu0) * 1e8 / wall, rss, hwm);
+      ret = (n == cfg.presses ? 0 : -1);
+   }
+   else
+      printf("%7d %5d no action started\n", cfg.presses, cfg.presses);
+
+exit:
+   cleanup();
+   free(latency);
+   return ret;
+}
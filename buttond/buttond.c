@@ -0,0 +1,990 @@
+/*
+ *  Filename: buttond.c
+ *
+ *  Author: Ondrej Wisniewski (2015)
+ *
+ *  Description:
+ *  Detect button press events of push buttons and execute an
+ *  arbitrary shell command. Replaces foxbtn-exec and gpiobuttond.
+ *
+ *  Buttons are read from pluggable input sources:
+ *  - sysfs:    GPIO line given by its kernel GPIO number (src_sysfs.c)
+ *  - gpiochip: GPIO line given by <chip>:<line>, used via the GPIO
+ *              character device, debounced and timestamped by the
+ *              kernel (src_gpiochip.c)
+ *  - evdev:    key of an input device given by <device>:<key>, e.g.
+ *              the FoxBoard on-board button, or of any input device
+ *              given by *:<key>. Input devices plugged in later are
+ *              picked up (src_evdev.c).
+ *
+ *  All buttons are handled by one process: the devices are opened
+ *  once at setup and watched with a single epoll instance. Presses are
+ *  classified by the gesture engine (see btn_common/btn_gesture.c):
+ *  a long press command is run as soon as the button has been held
+ *  long enough, not at its release. Double clicks and several long
+ *  press stages per button can be configured. Commands are started
+ *  without waiting for them (see btn_common/btn_exec.c), so button
+ *  events are handled while a command is running.
+ *
+ *  With -e the gestures are also published to local subscribers over
+ *  a Unix datagram socket or a shared ring buffer (see
+ *  btn_common/btn_event.c), so services can react to a button without
+ *  a process being started. Gestures may then be configured without
+ *  command.
+ *
+ *  The configuration file is reloaded on SIGHUP and when it is changed
+ *  (inotify). Commands and gesture timings are replaced between two
+ *  events, the devices of buttons still configured are kept open, so
+ *  no press is missed while reloading.
+ *
+ *  Build:
+ *  make
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <libgen.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <linux/input.h>
+
+#include "buttond.h"
+#include "btn_event.h"
+
+#define CONFIG_FILE "/etc/buttond.conf"
+
+/* define the timeout of a short button press, everything
+ * longer than that will be a long button press (default
+ * long press stage)
+ */
+#define SHORT_TIMEOUT 3
+
+/* key of an input device given without key (FoxBoard on-board button) */
+#define DEFAULT_KEY BTN_1
+
+BUTTON_t buttons[MAX_BUTTONS];
+int num_buttons=0;
+DEVICE_t devices[MAX_DEVICES];
+int num_devices=0;
+
+static const SOURCE_t *sources[] = { &source_sysfs, &source_gpiochip, &source_evdev };
+#define NUM_SOURCES (sizeof(sources)/sizeof(sources[0]))
+
+static volatile int running=1;
+static volatile int reload=0;
+static int epfd=-1;
+static int publish=0;
+
+/* configuration file, NULL if the button is given on the command line */
+static const char *config_file=NULL;
+static int cfd=-1;
+
+/* sources whose watch fd is in the event loop */
+static int watching[NUM_SOURCES];
+
+/* epoll event data of the signalfd, the timerfd, the event socket and
+ * the inotify fd of the configuration file (the watch fd of a source
+ * has the source, a device fd the device)
+ */
+static char exec_event, timer_event, publish_event, config_event;
+
+
+/*********************************************************************
+ * Function: addDevice()
+ *
+ * Description: Adds a device, or returns the existing one
+ *
+ * Parameters: source - input source
+ *             path   - GPIO chip or input device, empty for sysfs
+ *             line   - Kernel ID of GPIO pin or line offset
+ *
+ * Return:     device, NULL if too many devices
+ *
+ ********************************************************************/
+DEVICE_t* addDevice(const SOURCE_t *source, const char *path, uint32_t line)
+{
+   DEVICE_t *dev;
+   int i;
+
+   for (i=0; i<num_devices; i++) {
+      dev = &devices[i];
+      if (dev->source == source && strcmp(dev->path, path) == 0 && dev->line == line)
+         return dev;
+   }
+   if (num_devices == MAX_DEVICES) {
+      fprintf(stderr, "Too many devices (max %d)\n", MAX_DEVICES);
+      return NULL;
+   }
+
+   dev = &devices[num_devices++];
+   dev->source = source;
+   strcpy(dev->path, path);
+   dev->line = line;
+   dev->fd = -1;
+   dev->kernel_time = 0;
+   return dev;
+}
+
+
+/*********************************************************************
+ * Function: watchDevice()
+ *
+ * Description: Adds a device which has been set up to the event loop
+ *
+ * Parameters: dev - device
+ *
+ * Return:     0 on success, -1 on error
+ *
+ ********************************************************************/
+int watchDevice(DEVICE_t *dev)
+{
+   struct epoll_event ev;
+
+   ev.events = dev->source->epoll_events;
+   ev.data.ptr = dev;
+   if (epoll_ctl(epfd, EPOLL_CTL_ADD, dev->fd, &ev) < 0) {
+      fprintf(stderr, "epoll_ctl() failed: %s\n", strerror(errno));
+      return -1;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function: removeDevice()
+ *
+ * Description: Closes a device which is gone (closing removes it from
+ *              the event loop). Presses in progress of its buttons, and
+ *              of the keys on any device pressed on it, are dropped, so
+ *              they do not end as long press. The slot of a device only
+ *              opened for the keys on any device is freed, the last
+ *              device takes it.
+ *
+ * Parameters: dev - device
+ *
+ ********************************************************************/
+void removeDevice(DEVICE_t *dev)
+{
+   DEVICE_t *last = &devices[num_devices-1];
+   struct epoll_event ev;
+   int i, used=0;
+
+   fprintf(stderr, "%s removed\n", dev->path);
+   dev->source->cleanup(dev);
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].dev == dev)
+         used = 1;
+      if (buttons[i].input.pressed && (buttons[i].dev == dev || buttons[i].pressed_by == dev))
+         btnGestureReset(&buttons[i].input);
+      if (buttons[i].pressed_by == dev)
+         buttons[i].pressed_by = NULL;
+   }
+   if (used)
+      return;
+
+   // Events of the last device still pending in the event loop are
+   // skipped (fd -1) and reported again at its new address
+   if (dev != last) {
+      *dev = *last;
+      for (i=0; i<num_buttons; i++) {
+         if (buttons[i].dev == last)
+            buttons[i].dev = dev;
+         if (buttons[i].pressed_by == last)
+            buttons[i].pressed_by = dev;
+      }
+      ev.events = dev->source->epoll_events;
+      ev.data.ptr = dev;
+      if (dev->fd >= 0 && epoll_ctl(epfd, EPOLL_CTL_MOD, dev->fd, &ev) < 0)
+         fprintf(stderr, "epoll_ctl() failed: %s\n", strerror(errno));
+   }
+   last->fd = -1;
+   num_devices--;
+}
+
+
+/*********************************************************************
+ * Function: addButton()
+ *
+ * Description: Adds a button, or returns the existing one with the
+ *              same name
+ *
+ * Parameters: name - button as configured:
+ *                    <pin>          Kernel ID of GPIO pin (sysfs)
+ *                    <chip>:<line>  line of GPIO chip (character device)
+ *                    <device>:<key> key of input device
+ *                    <device>       BTN_1 of input device
+ *                    chip and device are names in /dev, /dev/input or
+ *                    paths, device * is any input device
+ *
+ * Return:     button, NULL if the name is invalid or too many buttons
+ *
+ ********************************************************************/
+static BUTTON_t* addButton(const char *name)
+{
+   BUTTON_t *button;
+   const SOURCE_t *source;
+   DEVICE_t *dev;
+   char path[MAX_NAME_LEN];
+   const char *p, *base;
+   char *end;
+   unsigned long n;
+   int i, len, code=0;
+
+   for (i=0; i<num_buttons; i++) {
+      if (strcmp(buttons[i].name, name) == 0)
+         return &buttons[i];
+   }
+   if (num_buttons == MAX_BUTTONS) {
+      fprintf(stderr, "Too many buttons (max %d)\n", MAX_BUTTONS);
+      return NULL;
+   }
+   if (strlen(name) >= MAX_NAME_LEN)
+      goto invalid;
+
+   // Device part and its file name
+   p = strrchr(name, ':');
+   len = (p ? p-name : strlen(name));
+   for (base=name+len; base>name && base[-1] != '/'; base--);
+
+   path[0] = 0;
+   n = 0;
+   if (strncmp(base, "gpiochip", 8) == 0) {
+      source = &source_gpiochip;
+      if (p == NULL)
+         goto invalid;
+      n = strtoul(p+1, &end, 10);
+      if (end == p+1 || *end)
+         goto invalid;
+      snprintf(path, sizeof(path), "%s%.*s", *name == '/' ? "" : "/dev/", len, name);
+   }
+   else if (strncmp(base, "event", 5) == 0 || strstr(name, "/input/") ||
+            (len == 1 && *name == *ANY_DEVICE)) {
+      source = &source_evdev;
+      code = (p ? evdevKeyCode(p+1) : DEFAULT_KEY);
+      if (code < 0)
+         goto invalid;
+      if (len == 1 && *name == *ANY_DEVICE)
+         strcpy(path, ANY_DEVICE);
+      else
+         snprintf(path, sizeof(path), "%s%.*s", *name == '/' ? "" : "/dev/input/", len, name);
+   }
+   else {
+      source = &source_sysfs;
+      n = strtoul(name, &end, 10);
+      if (p || end == name || *end || n == 0)
+         goto invalid;
+   }
+
+   dev = addDevice(source, path, n);
+   if (dev == NULL)
+      return NULL;
+
+   button = &buttons[num_buttons];
+   memset(button, 0, sizeof(BUTTON_t));
+   strcpy(button->name, name);
+   button->dev = dev;
+   button->code = code;
+   button->input.ctx = button;
+   btnActionSet(&button->cmd_short, NULL);
+   btnActionSet(&button->cmd_double, NULL);
+   num_buttons++;
+   return button;
+
+invalid:
+   fprintf(stderr, "Invalid button \"%s\"\n", name);
+   return NULL;
+}
+
+
+/*********************************************************************
+ * Function: longStage()
+ *
+ * Description: Returns the long press stage of a button with the given
+ *              threshold, a new stage is inserted in ascending order
+ *
+ * Parameters: button - button
+ *             ms     - threshold of the stage (ms)
+ *
+ * Return:     command of the stage, NULL if too many stages
+ *
+ ********************************************************************/
+static BTN_ACTION_t* longStage(BUTTON_t *button, uint32_t ms)
+{
+   BTN_INPUT_t *input = &button->input;
+   int i;
+
+   for (i=0; i<input->num_stages && input->long_press[i] < ms; i++);
+   if (i < input->num_stages && input->long_press[i] == ms)
+      return &button->cmd_long[i];
+   if (input->num_stages == BTN_MAX_STAGES) {
+      fprintf(stderr, "Too many long press stages (max %d)\n", BTN_MAX_STAGES);
+      return NULL;
+   }
+
+   memmove(&input->long_press[i+1], &input->long_press[i],
+           (input->num_stages-i)*sizeof(input->long_press[0]));
+   btnActionMove(&button->cmd_long[i+1], &button->cmd_long[i], input->num_stages-i);
+   input->long_press[i] = ms;
+   input->num_stages++;
+   btnActionSet(&button->cmd_long[i], NULL);
+   return &button->cmd_long[i];
+}
+
+
+/*********************************************************************
+ * Function: readConfig()
+ *
+ * Description: Reads the buttons from the configuration file. Each
+ *              line defines the command for one gesture of a button:
+ *
+ *                <button> short|double|long[:<ms>] [max:<n>] [<shell command>]
+ *
+ *              button is given as described at addButton(). long
+ *              without time is the long press after SHORT_TIMEOUT,
+ *              several long press stages are defined with different
+ *              times. max:<n> lets the command run in up to n instances
+ *              at the same time (default BTN_MAX_RUNNING). A gesture
+ *              without command is only published (-e). Empty lines and
+ *              lines starting with # are ignored.
+ *
+ * Parameters: filename - name of configuration file
+ *
+ * Return:     0 on success, error code otherwise
+ *
+ ********************************************************************/
+static int readConfig(const char *filename)
+{
+   FILE *f;
+   char line[BTN_MAX_CMD_LEN+MAX_NAME_LEN+32];
+   char name[MAX_NAME_LEN];
+   char press[16];
+   char *cmd;
+   BUTTON_t *button;
+   BTN_ACTION_t *action;
+   unsigned int ms, max;
+   int n, lineno=0;
+
+   f = fopen(filename, "r");
+   if (f == NULL) {
+      fprintf(stderr, "Open %s: %s\n", filename, strerror(errno));
+      return 1;
+   }
+
+   while (fgets(line, sizeof(line), f) != NULL) {
+      lineno++;
+      line[strcspn(line, "\r\n")] = 0;
+      for (cmd=line; isspace((unsigned char)*cmd); cmd++);
+      if (*cmd == 0 || *cmd == '#')
+         continue;
+
+      ms = SHORT_TIMEOUT*1000;
+      if (sscanf(cmd, "%63s %15s %n", name, press, &n) != 2 ||
+          (strcmp(press, "short") != 0 && strcmp(press, "double") != 0 &&
+           strcmp(press, "long") != 0 && (sscanf(press, "long:%u", &ms) != 1 || ms == 0))) {
+         fprintf(stderr, "%s:%d: expected '<button> short|double|long[:<ms>] [max:<n>] [<command>]'\n",
+                 filename, lineno);
+         fclose(f);
+         return 2;
+      }
+      cmd += n;
+
+      max = BTN_MAX_RUNNING;
+      if (strncmp(cmd, "max:", 4) == 0) {
+         if (sscanf(cmd, "max:%u %n", &max, &n) != 1 || max == 0 || max > BTN_MAX_CHILDREN ||
+             (cmd[n] && !isspace((unsigned char)cmd[n-1]))) {
+            fprintf(stderr, "%s:%d: expected max:<n> with n from 1 to %d\n",
+                    filename, lineno, BTN_MAX_CHILDREN);
+            fclose(f);
+            return 2;
+         }
+         cmd += n;
+      }
+
+      button = addButton(name);
+      if (button == NULL) {
+         fclose(f);
+         return 4;
+      }
+      if (strcmp(press, "short") == 0)
+         action = &button->cmd_short;
+      else if (strcmp(press, "double") == 0) {
+         action = &button->cmd_double;
+         button->input.double_click = BTN_DOUBLE_CLICK;
+      }
+      else
+         action = longStage(button, ms);
+      if (action == NULL) {
+         fclose(f);
+         return 4;
+      }
+      if (btnActionSet(action, cmd) != 0) {
+         fprintf(stderr, "%s:%d: invalid command\n", filename, lineno);
+         fclose(f);
+         return 3;
+      }
+      action->max_running = max;
+   }
+   fclose(f);
+
+   if (num_buttons == 0) {
+      fprintf(stderr, "No buttons defined in %s\n", filename);
+      return 5;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    defaultStages()
+ *
+ * Description: Adds the default long press stage to buttons without
+ *              long press command, so a press of more than
+ *              SHORT_TIMEOUT is still no short press
+ *
+ ********************************************************************/
+static void defaultStages(void)
+{
+   int i;
+
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].input.num_stages == 0)
+         longStage(&buttons[i], SHORT_TIMEOUT*1000);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    deviceUsed()
+ *
+ * Description: Checks if a device is used by a button, directly or as
+ *              one of the open devices of a key on any device
+ *
+ ********************************************************************/
+static int deviceUsed(const DEVICE_t *dev)
+{
+   int i;
+
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].dev == dev || (dev->fd >= 0 && buttons[i].dev->source == dev->source &&
+                                    strcmp(buttons[i].dev->path, ANY_DEVICE) == 0))
+         return 1;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    setupDevices()
+ *
+ * Description: Sets up the devices from the given index on and adds
+ *              them to the event loop. Devices which are not present
+ *              (fd -1) are opened on hotplug.
+ *
+ * Parameters:  first - index of the first device
+ *
+ * Return:      0 on success, error code otherwise
+ *
+ ********************************************************************/
+static int setupDevices(int first)
+{
+   DEVICE_t *dev;
+   int i, n = num_devices;
+
+   for (i=first; i<n; i++) {
+      dev = &devices[i];
+      if (dev->source->setup(dev) != 0)
+         return 4;
+      if (dev->fd >= 0 && watchDevice(dev) != 0)
+         return 5;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    watchSources()
+ *
+ * Description: Starts the hotplug of the sources in use, a source
+ *              already watched opens the devices which are present
+ *              but not open yet
+ *
+ * Return:      0 on success, error code otherwise
+ *
+ ********************************************************************/
+static int watchSources(void)
+{
+   struct epoll_event ev;
+   const SOURCE_t *source;
+   int wfd, i, j;
+
+   for (i=0; i<NUM_SOURCES; i++) {
+      source = sources[i];
+      for (j=0; j<num_devices && devices[j].source != source; j++);
+      if (j == num_devices || source->watch == NULL)
+         continue;
+
+      wfd = source->watch();
+      if (wfd < 0)
+         return 5;
+      if (watching[i])
+         continue;
+      ev.events = EPOLLIN;
+      ev.data.ptr = (void *)source;
+      if (epoll_ctl(epfd, EPOLL_CTL_ADD, wfd, &ev) < 0) {
+         fprintf(stderr, "epoll_ctl() failed: %s\n", strerror(errno));
+         return 5;
+      }
+      watching[i] = 1;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    reloadConfig()
+ *
+ * Description: Reads the configuration file again and replaces the
+ *              buttons with their commands and gesture timings. If the
+ *              file is invalid, the current configuration is kept.
+ *              Devices still in use are kept open (sysfs pins stay
+ *              exported, GPIO lines requested), devices no longer in
+ *              use are closed and new ones set up. A press in progress
+ *              continues with the new timings, running commands are
+ *              not waited for.
+ *
+ * Return:      0 on success, -1 if the configuration was kept
+ *
+ ********************************************************************/
+static int reloadConfig(void)
+{
+   static BUTTON_t old[MAX_BUTTONS];
+   struct epoll_event ev;
+   uint8_t keep[MAX_DEVICES];
+   int num_old = num_buttons, old_devices = num_devices;
+   int i, j, n;
+
+   if (config_file == NULL) {
+      fprintf(stderr, "No configuration file to reload\n");
+      return -1;
+   }
+
+   // Parse into the button table, restored if the file is invalid
+   memcpy(old, buttons, num_old*sizeof(BUTTON_t));
+   num_buttons = 0;
+   if (readConfig(config_file) != 0) {
+      memcpy(buttons, old, num_old*sizeof(BUTTON_t));
+      num_buttons = num_old;
+      num_devices = old_devices;
+      fprintf(stderr, "Configuration of %s kept\n", config_file);
+      return -1;
+   }
+   defaultStages();
+
+   // Swap actions and gesture timings
+   btnExecDetach();
+   btnGestureClear();
+   for (i=0; i<num_buttons; i++) {
+      btnGestureAdd(&buttons[i].input);
+      for (j=0; j<num_old && strcmp(old[j].name, buttons[i].name) != 0; j++);
+      if (j < num_old) {
+         btnGestureTransfer(&buttons[i].input, &old[j].input);
+         buttons[i].pressed_by = old[j].pressed_by;
+      }
+      else
+         printf("using %s button %s\n", buttons[i].dev->source->name, buttons[i].name);
+   }
+
+   // Close the devices no longer used, set up the new ones
+   for (i=0; i<num_devices; i++) {
+      keep[i] = deviceUsed(&devices[i]);
+      if (!keep[i] && i < old_devices) {
+         if (devices[i].path[0])
+            printf("%s released\n", devices[i].path);
+         else
+            printf("pin %u released\n", (unsigned int)devices[i].line);
+         devices[i].source->cleanup(&devices[i]);
+         for (j=0; j<num_buttons; j++) {
+            if (buttons[j].pressed_by == &devices[i])
+               buttons[j].pressed_by = NULL;
+         }
+      }
+   }
+   if (setupDevices(old_devices) != 0)
+      fprintf(stderr, "Unable to set up the new devices\n");
+
+   // Remove the closed devices, moved devices get their new address
+   for (i=0, n=0; i<num_devices; i++) {
+      if (!keep[i])
+         continue;
+      if (n != i) {
+         devices[n] = devices[i];
+         for (j=0; j<num_buttons; j++) {
+            if (buttons[j].dev == &devices[i])
+               buttons[j].dev = &devices[n];
+            if (buttons[j].pressed_by == &devices[i])
+               buttons[j].pressed_by = &devices[n];
+         }
+         ev.events = devices[n].source->epoll_events;
+         ev.data.ptr = &devices[n];
+         if (devices[n].fd >= 0 && epoll_ctl(epfd, EPOLL_CTL_MOD, devices[n].fd, &ev) < 0)
+            fprintf(stderr, "epoll_ctl() failed: %s\n", strerror(errno));
+      }
+      n++;
+   }
+   num_devices = n;
+
+   if (watchSources() != 0)
+      fprintf(stderr, "Unable to watch the new devices\n");
+   printf("%s reloaded, %d buttons\n", config_file, num_buttons);
+   fflush(stdout);
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    configChanged()
+ *
+ * Description: Checks the inotify events of the directory of the
+ *              configuration file for a change of the file
+ *
+ * Return:      1 if the file was changed
+ *
+ ********************************************************************/
+static int configChanged(void)
+{
+   char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+   char path[256];
+   const struct inotify_event *ev;
+   const char *name;
+   int n, changed = 0;
+   char *p;
+
+   snprintf(path, sizeof(path), "%s", config_file);
+   name = basename(path);
+   while ((n = read(cfd, buf, sizeof(buf))) > 0) {
+      for (p=buf; p<buf+n; p+=sizeof(struct inotify_event)+ev->len) {
+         ev = (const struct inotify_event *)p;
+         if (ev->len && strcmp(ev->name, name) == 0)
+            changed = 1;
+      }
+   }
+   return changed;
+}
+
+
+/*********************************************************************
+ * Function:    handleGesture()
+ *
+ * Description: Publishes a gesture detected on a button and runs its
+ *              command
+ *
+ * Parameters:  input    - gesture state of the button
+ *              gesture  - detected gesture
+ *              stage    - long press stage
+ *              duration - time the button was held (ms)
+ *
+ ********************************************************************/
+static void handleGesture(BTN_INPUT_t *input, BTN_GESTURE_t gesture,
+                          int stage, uint32_t duration)
+{
+   static const char *names[] = { "short", "double", "long" };
+   BUTTON_t *button = input->ctx;
+   BTN_ACTION_t *action;
+
+   switch (gesture)
+   {
+      case GESTURE_SHORT:
+         action = &button->cmd_short;
+         break;
+      case GESTURE_DOUBLE:
+         action = &button->cmd_double;
+         break;
+      default:
+         action = &button->cmd_long[stage-1];
+         break;
+   }
+
+   if (publish)
+      btnEventPublish(button->name, gesture, stage, duration);
+
+   if (action->argv[0]) {
+      fprintf(stderr, "Executing shell command \"%s\" \n", action->cmd);
+      btnExecRun(action);
+   }
+   else if (!publish)
+      fprintf(stderr, "Push button %s %s press (%u ms, no command specified)\n",
+              button->name, names[gesture], (unsigned int)duration);
+}
+
+
+/*********************************************************************
+ * Function:    buttonEvent()
+ *
+ * Description: Passes a press or release read by an input source to
+ *              the gesture engine
+ *
+ * Parameters:  dev     - device
+ *              code    - key code (input device), 0 for GPIO
+ *              pressed - 1 if the button was pressed, 0 if released
+ *              time    - time of the event (ms, CLOCK_MONOTONIC)
+ *
+ ********************************************************************/
+void buttonEvent(DEVICE_t *dev, unsigned int code, int pressed, uint64_t time)
+{
+   BUTTON_t *button;
+   int i;
+
+   for (i=0; i<num_buttons; i++) {
+      button = &buttons[i];
+      if (button->code != code || (button->dev != dev &&
+          (button->dev->source != dev->source || strcmp(button->dev->path, ANY_DEVICE) != 0)))
+         continue;
+
+      if (pressed && !button->input.pressed) {
+         fprintf(stderr, "Push button %s press started\n", button->name);
+         button->pressed_by = dev;
+      }
+      btnGestureEdge(&button->input, pressed, time);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    doExit()
+ *
+ * Description: Signal handler function to do a clean shutdown
+ *
+ * Parameters:  the received signal
+ *
+ ********************************************************************/
+static void doExit(int signum)
+{
+   running = 0;
+}
+
+/*********************************************************************
+ * Function:    doReload()
+ *
+ * Description: Signal handler function to reload the configuration
+ *
+ * Parameters:  the received signal
+ *
+ ********************************************************************/
+static void doReload(int signum)
+{
+   reload = 1;
+}
+
+
+static void usage(const char *prog)
+{
+   printf("Usage: %s [-g] [-e] <button> [cmd1] [cmd2]\n", prog);
+   printf("       %s [-g] [-e] -c [config file]\n", prog);
+   printf("  -g     = grab the input devices (their events are not passed to other programs)\n");
+   printf("  -e     = publish the gestures to subscribers of %s\n", BTN_EVENT_SOCKET);
+   printf("  button = Kernel Id of GPIO pin (sysfs), <chip>:<line> (GPIO character device)\n");
+   printf("           or <input device>[:<key>] (key default: BTN_1, device * is any)\n");
+   printf("  cmd1   = shell command to execute in case of short button press (less than %ds)\n", SHORT_TIMEOUT);
+   printf("  cmd2   = shell command to execute in case of long button press (after %ds)\n", SHORT_TIMEOUT);
+   printf("  config file = file with one line per button command (default: %s):\n", CONFIG_FILE);
+   printf("                <button> short|double|long[:<ms>] [<shell command>]\n");
+   printf("                reloaded on SIGHUP and when it is changed\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   struct epoll_event events[MAX_DEVICES+NUM_SOURCES+3];
+   struct epoll_event ev;
+   struct sigaction sa;
+   sigset_t mask, wait_mask;
+   BUTTON_t *button;
+   DEVICE_t *dev;
+   char dir[256];
+   int sfd, tfd, efd, n, i, j;
+   int ret = 0;
+
+   while (argc > 1 && (strcmp(argv[1], "-g") == 0 || strcmp(argv[1], "-e") == 0)) {
+      if (argv[1][1] == 'g')
+         evdevSetGrab(1);
+      else
+         publish = 1;
+      argc--;
+      argv++;
+   }
+   if (argc < 2) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   if (strcmp(argv[1], "-c") == 0) {
+      config_file = (argc > 2 ? argv[2] : CONFIG_FILE);
+      if (readConfig(config_file) != 0)
+         return 2;
+   }
+   else {
+      button = addButton(argv[1]);
+      if (button == NULL ||
+          (argc > 2 && btnActionSet(&button->cmd_short, argv[2]) != 0) ||
+          (argc > 3 && btnActionSet(longStage(button, SHORT_TIMEOUT*1000), argv[3]) != 0))
+         return 2;
+   }
+
+   defaultStages();
+
+   /* Install signal handler for SIGTERM and SIGINT ("CTRL C")
+    * to be used to cleanly terminate the event loop and for SIGHUP
+    * to reload the configuration (no SA_RESTART, so epoll_pwait()
+    * returns)
+    */
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = doExit;
+   sigaction(SIGTERM, &sa, NULL);
+   sigaction(SIGINT, &sa, NULL);
+   sa.sa_handler = doReload;
+   sigaction(SIGHUP, &sa, NULL);
+
+   epfd = epoll_create1(EPOLL_CLOEXEC);
+   if (epfd < 0) {
+      fprintf(stderr, "epoll_create1() failed: %s\n", strerror(errno));
+      return 3;
+   }
+
+   // Exited commands are reported via signalfd
+   sfd = btnExecInit();
+   ev.events = EPOLLIN;
+   ev.data.ptr = &exec_event;
+   if (sfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev) < 0) {
+      ret = 3;
+      goto exit;
+   }
+
+   // Long press and double click timeouts are reported via timerfd
+   tfd = btnGestureInit(handleGesture);
+   ev.events = EPOLLIN;
+   ev.data.ptr = &timer_event;
+   if (tfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev) < 0) {
+      ret = 3;
+      goto exit;
+   }
+
+   // Subscriber requests are received on the event socket
+   if (publish) {
+      efd = btnEventInit(BTN_EVENT_SOCKET);
+      ev.events = EPOLLIN;
+      ev.data.ptr = &publish_event;
+      if (efd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev) < 0) {
+         ret = 3;
+         goto exit;
+      }
+   }
+
+   for (i=0; i<num_buttons; i++) {
+      printf("using %s button %s\n", buttons[i].dev->source->name, buttons[i].name);
+      btnGestureAdd(&buttons[i].input);
+   }
+
+   ret = setupDevices(0);
+   if (ret == 0)
+      ret = watchSources();
+   if (ret != 0)
+      goto exit;
+
+   // Changes of the configuration file (also replaced by an editor)
+   if (config_file) {
+      snprintf(dir, sizeof(dir), "%s", config_file);
+      cfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      ev.events = EPOLLIN;
+      ev.data.ptr = &config_event;
+      if (cfd < 0 || inotify_add_watch(cfd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+          epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &ev) < 0)
+         fprintf(stderr, "Unable to watch %s: %s\n", config_file, strerror(errno));
+   }
+   fflush(stdout);
+
+   // The signals are only delivered while waiting for events, so none
+   // is missed between checking the flags and waiting
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGTERM);
+   sigaddset(&mask, SIGINT);
+   sigaddset(&mask, SIGHUP);
+   sigprocmask(SIG_BLOCK, &mask, &wait_mask);
+   sigdelset(&wait_mask, SIGTERM);
+   sigdelset(&wait_mask, SIGINT);
+   sigdelset(&wait_mask, SIGHUP);
+
+   while (running) {
+
+      if (reload) {
+         reload = 0;
+         reloadConfig();
+      }
+
+      n = epoll_pwait(epfd, events, MAX_DEVICES+NUM_SOURCES+3, -1, &wait_mask);
+      if (n < 0) {
+         if (errno == EINTR)
+            continue;
+         fprintf(stderr, "epoll_pwait() failed: %s\n", strerror(errno));
+         ret = 6;
+         break;
+      }
+
+      for (i=0; i<n; i++) {
+         if (events[i].data.ptr == &exec_event)
+            btnExecReap();
+         else if (events[i].data.ptr == &timer_event)
+            btnGestureTimer();
+         else if (events[i].data.ptr == &publish_event)
+            btnEventRequest();
+         else if (events[i].data.ptr == &config_event) {
+            // the devices of the remaining events may have moved
+            if (configChanged() && reloadConfig() == 0)
+               break;
+         }
+         else {
+            for (j=0; j<NUM_SOURCES && events[i].data.ptr != sources[j]; j++);
+            if (j < NUM_SOURCES)
+               sources[j]->hotplug();
+            else {
+               dev = events[i].data.ptr;
+               if (dev->fd >= 0)
+                  dev->source->read(dev);
+            }
+         }
+      }
+   }
+
+exit:
+   for (i=0; i<num_devices; i++)
+      devices[i].source->cleanup(&devices[i]);
+   if (cfd >= 0)
+      close(cfd);
+   btnEventCleanup();
+   btnGestureCleanup();
+   btnExecCleanup();
+   close(epfd);
+   return ret;
+}
@@ -0,0 +1,107 @@
+/*
+ *  Filename: buttond.h
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Definitions shared by the button daemon and its input sources.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+
+#ifndef buttond_h
+#define buttond_h
+
+#include <stdint.h>
+
+#include "btn_exec.h"
+#include "btn_gesture.h"
+
+#define NAME "buttond"
+
+/* max number of buttons and of devices they are connected to */
+#define MAX_BUTTONS 32
+#define MAX_DEVICES 32
+
+/* max length of a button or device name */
+#define MAX_NAME_LEN 64
+
+/* device name of a key on any input device */
+#define ANY_DEVICE "*"
+
+struct SOURCE_s;
+
+/* Device delivering button events: a GPIO line or an input device */
+typedef struct {
+   const struct SOURCE_s *source;
+   char path[MAX_NAME_LEN];     // GPIO chip or input device, empty for sysfs
+   uint32_t line;               // Kernel ID of GPIO pin (sysfs) or line
+                                // offset on the GPIO chip
+   int fd;                      // -1 if not set up or not present
+   uint8_t kernel_time;         // events carry CLOCK_MONOTONIC timestamps
+}
+DEVICE_t;
+
+/* Input source: sets up devices of one kind and reads their events */
+typedef struct SOURCE_s {
+   const char *name;
+   uint32_t epoll_events;             // events to wait for on the device fd
+   int  (*setup)(DEVICE_t *dev);      // opens dev->fd, 0 on success
+   void (*read)(DEVICE_t *dev);       // reads the events, calls buttonEvent()
+   void (*cleanup)(DEVICE_t *dev);    // closes dev->fd
+   int  (*watch)(void);               // optional: opens the devices present
+                                      // and returns an fd reporting hotplug
+                                      // (again after a reload: same fd)
+   void (*hotplug)(void);             // handles the events of the watch fd
+}
+SOURCE_t;
+
+/* Button: a GPIO line or a key of an input device */
+typedef struct {
+   char name[MAX_NAME_LEN];     // button as configured
+   DEVICE_t *dev;
+   DEVICE_t *pressed_by;        // device of the latest press (any device)
+   unsigned int code;           // key code (input device), 0 for GPIO
+   BTN_INPUT_t input;           // gesture state
+   BTN_ACTION_t cmd_short;      // short button press command
+   BTN_ACTION_t cmd_double;     // double click command
+   BTN_ACTION_t cmd_long[BTN_MAX_STAGES];  // long press command per stage
+}
+BUTTON_t;
+
+/* buttond.c */
+extern BUTTON_t buttons[MAX_BUTTONS];
+extern int num_buttons;
+extern DEVICE_t devices[MAX_DEVICES];
+extern int num_devices;
+
+DEVICE_t* addDevice(const SOURCE_t *source, const char *path, uint32_t line);
+int  watchDevice(DEVICE_t *dev);
+void removeDevice(DEVICE_t *dev);
+void buttonEvent(DEVICE_t *dev, unsigned int code, int pressed, uint64_t time);
+
+/* input sources */
+extern const SOURCE_t source_sysfs;    // src_sysfs.c
+extern const SOURCE_t source_gpiochip; // src_gpiochip.c
+extern const SOURCE_t source_evdev;    // src_evdev.c
+
+int  evdevKeyCode(const char *name);
+void evdevSetGrab(int grab);
+
+#endif /*buttond_h*/
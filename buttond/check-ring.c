@@ -0,0 +1,209 @@
+/*
+ *  Filename: check-ring.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Checks the ring buffer of btn_common/btn_event.c: a subscriber reads
+ *  the published gestures, but can neither map the ring buffer
+ *  writable, nor write it, nor get write access by reopening it.
+ *  The daemon socket is created in a temporary directory.
+ *
+ *  Build and run:
+ *  make check
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "btn_event.h"
+
+#define NUM_EVENTS 3
+
+static char sock_path[108];
+static int ready[2];          // pipe: subscriber ready for the events
+static int failed=0;
+
+
+static void check(int ok, const char *what)
+{
+   printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+   if (!ok)
+      failed = 1;
+}
+
+/*********************************************************************
+ * Function:    requestRing()
+ *
+ * Description: Sends a ring subscription as btnEventSubscribe() does
+ *              and returns the memfd of the reply
+ *
+ * Return:      memfd, -1 on error
+ *
+ ********************************************************************/
+static int requestRing(void)
+{
+   union {
+      struct cmsghdr hdr;
+      char b[CMSG_SPACE(2*sizeof(int))];
+   } ctrl;
+   struct sockaddr_un addr;
+   struct msghdr msg;
+   struct cmsghdr *cmsg;
+   struct iovec iov;
+   char b[32];
+   int fd, fds[2];
+
+   fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(sa_family_t)) < 0)
+      return -1;
+   strcpy(addr.sun_path, sock_path);
+   if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       send(fd, BTN_SUBSCRIBE_RING, strlen(BTN_SUBSCRIBE_RING), 0) < 0)
+      return -1;
+
+   memset(&msg, 0, sizeof(msg));
+   iov.iov_base = b;
+   iov.iov_len = sizeof(b);
+   msg.msg_iov = &iov;
+   msg.msg_iovlen = 1;
+   msg.msg_control = ctrl.b;
+   msg.msg_controllen = sizeof(ctrl.b);
+   if (recvmsg(fd, &msg, 0) < 0 || (cmsg = CMSG_FIRSTHDR(&msg)) == NULL)
+      return -1;
+   memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+   close(fds[1]);
+   return fds[0];
+}
+
+/*********************************************************************
+ * Function:    subscriber()
+ *
+ * Description: Tries to get write access to the ring buffer, then
+ *              reads the published events
+ *
+ * Return:      exit code, 0 if all checks passed
+ *
+ ********************************************************************/
+static int subscriber(void)
+{
+   BTN_RING_t *ring;
+   BTN_EVENT_t ev;
+   struct pollfd pfd;
+   char path[64];
+   uint64_t count;
+   uint32_t tail;
+   void *p;
+   int fd, rfd, efd, n=0;
+
+   rfd = requestRing();
+   check(rfd >= 0, "ring subscription");
+   if (rfd < 0)
+      return 1;
+
+   p = mmap(NULL, sizeof(BTN_RING_t), PROT_READ | PROT_WRITE, MAP_SHARED, rfd, 0);
+   check(p == MAP_FAILED, "ring buffer cannot be mapped writable");
+   check(pwrite(rfd, "x", 1, 0) < 0, "ring buffer cannot be written");
+   p = mmap(NULL, sizeof(BTN_RING_t), PROT_READ, MAP_SHARED, rfd, 0);
+   check(p != MAP_FAILED && mprotect(p, sizeof(BTN_RING_t), PROT_READ | PROT_WRITE) < 0,
+         "read only mapping cannot be made writable");
+   snprintf(path, sizeof(path), "/proc/self/fd/%d", rfd);
+   fd = open(path, O_RDWR);
+   check(fd < 0 || pwrite(fd, "x", 1, 0) < 0, "reopened ring buffer cannot be written");
+   check(ftruncate(rfd, 0) < 0, "ring buffer cannot be resized");
+
+   fd = btnEventSubscribe(sock_path, &ring, &efd);
+   check(fd >= 0, "ring subscription with btnEventSubscribe()");
+   if (fd < 0)
+      return 1;
+   tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   close(ready[1]);
+   pfd.fd = efd;
+   pfd.events = POLLIN;
+   while (n < NUM_EVENTS && poll(&pfd, 1, 2000) == 1) {
+      if (read(efd, &count, sizeof(count)) < 0)
+         break;
+      while (btnRingRead(ring, &tail, &ev))
+         n++;
+   }
+   check(n == NUM_EVENTS, "published events read from the ring buffer");
+   return failed;
+}
+
+
+int main(int argc, char* argv[])
+{
+   char dir[] = "/tmp/check-ring.XXXXXX";
+   struct pollfd pfd[2];
+   pid_t pid;
+   int status, sock, i;
+
+   if (mkdtemp(dir) == NULL) {
+      perror("mkdtemp");
+      return 2;
+   }
+   snprintf(sock_path, sizeof(sock_path), "%s/buttond.sock", dir);
+   sock = btnEventInit(sock_path);
+   if (sock < 0) {
+      rmdir(dir);
+      return 2;
+   }
+
+   if (pipe(ready) < 0) {
+      perror("pipe");
+      return 2;
+   }
+   pid = fork();
+   if (pid == 0) {
+      close(ready[0]);
+      i = subscriber();
+      fflush(stdout);
+      _exit(i);
+   }
+   close(ready[1]);
+
+   // Handle the requests until the subscriber is ready (or gone), then
+   // publish
+   pfd[0].fd = sock;
+   pfd[0].events = POLLIN;
+   pfd[1].fd = ready[0];
+   pfd[1].events = POLLIN;
+   while (poll(pfd, 2, 5000) > 0 && !pfd[1].revents)
+      btnEventRequest();
+   for (i=0; i<NUM_EVENTS; i++)
+      btnEventPublish("check", GESTURE_SHORT, 0, 100);
+
+   waitpid(pid, &status, 0);
+   btnEventCleanup();
+   rmdir(dir);
+   return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
@@ -0,0 +1,129 @@
+/*
+ *  Filename: listen.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Subscribes to the gestures published by buttond (-e) and prints
+ *  them, one line per gesture:
+ *
+ *    <seq> <time ms> <button> short|double|long[:<stage>] <duration ms>
+ *
+ *  Also an example of a subscriber, see btn_common/btn_event.h.
+ *
+ *  Build:
+ *  make buttond-listen
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "btn_event.h"
+
+
+/*********************************************************************
+ * Function:    printEvent()
+ *
+ * Description: Prints a gesture
+ *
+ ********************************************************************/
+static void printEvent(const BTN_EVENT_t *ev)
+{
+   static const char *names[] = { "short", "double", "long" };
+
+   if (ev->gesture == GESTURE_LONG)
+      printf("%u %llu %.*s long:%u %u\n", ev->seq, (unsigned long long)ev->time,
+             BTN_EVENT_NAME_LEN, ev->source, ev->stage, ev->duration);
+   else if (ev->gesture < GESTURE_LONG)
+      printf("%u %llu %.*s %s %u\n", ev->seq, (unsigned long long)ev->time,
+             BTN_EVENT_NAME_LEN, ev->source, names[ev->gesture], ev->duration);
+   fflush(stdout);
+}
+
+
+static void usage(const char *prog)
+{
+   printf("Usage: %s [-r] [socket]\n", prog);
+   printf("  -r     = read the events from the shared ring buffer\n");
+   printf("  socket = socket of buttond (default: %s)\n", BTN_EVENT_SOCKET);
+}
+
+
+int main(int argc, char* argv[])
+{
+   BTN_RING_t *ring = NULL;
+   BTN_EVENT_t ev;
+   struct pollfd pfd;
+   const char *path = BTN_EVENT_SOCKET;
+   uint64_t count;
+   uint32_t tail;
+   int use_ring = 0;
+   int fd, efd = -1, n;
+
+   if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+      use_ring = 1;
+      argc--;
+      argv++;
+   }
+   if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+      usage(argv[0]);
+      return 1;
+   }
+   if (argc == 2)
+      path = argv[1];
+
+   fd = btnEventSubscribe(path, use_ring ? &ring : NULL, &efd);
+   if (fd < 0)
+      return 2;
+
+   if (!use_ring) {
+      while ((n = recv(fd, &ev, sizeof(ev), 0)) >= 0 || errno == EINTR) {
+         if (n == sizeof(ev))
+            printEvent(&ev);
+      }
+      fprintf(stderr, "recv() failed: %s\n", strerror(errno));
+      return 3;
+   }
+
+   // The socket stays open for the subscription, events are read from
+   // the ring buffer only
+   tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   pfd.fd = efd;
+   pfd.events = POLLIN;
+   for (;;) {
+      n = poll(&pfd, 1, -1);
+      if (n < 0 && errno != EINTR) {
+         fprintf(stderr, "poll() failed: %s\n", strerror(errno));
+         return 3;
+      }
+      if (n > 0 && (pfd.revents & POLLIN)) {
+         if (read(efd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            return 3;
+         while (btnRingRead(ring, &tail, &ev))
+            printEvent(&ev);
+      }
+   }
+}
@@ -0,0 +1,495 @@
+/*
+ *  Filename: src_evdev.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Input source for keys of input devices (/dev/input/event<X>), e.g.
+ *  the FoxBoard on-board push button provided by the gpio-keys kernel
+ *  driver. One device can deliver the events of several buttons.
+ *
+ *  Any number of input devices is monitored. /dev/input is watched
+ *  with inotify, so configured devices which are not present at start
+ *  or are unplugged and plugged again are opened when they appear.
+ *  Keys configured on any device (*:<key>) are read from all input
+ *  devices having one of these keys, including the ones plugged in
+ *  later. With grab set, the devices are grabbed (EVIOCGRAB), so their
+ *  events are not passed to other programs (e.g. the console).
+ *
+ *  Gestures are timed from the kernel timestamps of the events, set to
+ *  CLOCK_MONOTONIC (EVIOCSCLOCKID, Linux 3.4 or later), so the timing
+ *  stays accurate when the daemon is scheduled late on a loaded
+ *  system. If the event buffer of a device overruns (SYN_DROPPED), the
+ *  key states are read back from the device.
+ *
+ *  Based on code in evtest.c from Vojtech Pavlik
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <dirent.h>
+#include <libgen.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/inotify.h>
+#include <linux/input.h>
+
+#include "buttond.h"
+
+#ifndef INPUT_DIR
+#define INPUT_DIR "/dev/input"
+#endif
+
+/* max number of input events read at once */
+#define MAX_INPUT_EVENTS 64
+
+/* struct input_event has no struct timeval with 64 bit time_t on 32
+ * bit systems (kernel headers 4.16 or later)
+ */
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+#define BITS_PER_LONG (8*sizeof(long))
+#define TEST_BIT(bit, array) ((array[(bit)/BITS_PER_LONG] >> ((bit)%BITS_PER_LONG)) & 1)
+
+static int grab=0;
+static int ifd=-1;
+
+/* names of the key codes usually assigned to push buttons */
+#define KEY(k) { #k, k }
+static const struct {
+   const char *name;
+   unsigned int code;
+} key_names[] = {
+   KEY(BTN_0), KEY(BTN_1), KEY(BTN_2), KEY(BTN_3), KEY(BTN_4),
+   KEY(BTN_5), KEY(BTN_6), KEY(BTN_7), KEY(BTN_8), KEY(BTN_9),
+   KEY(BTN_LEFT), KEY(BTN_RIGHT), KEY(BTN_MIDDLE),
+   KEY(KEY_POWER), KEY(KEY_RESTART), KEY(KEY_SLEEP), KEY(KEY_WAKEUP),
+   KEY(KEY_ENTER), KEY(KEY_ESC), KEY(KEY_MENU), KEY(KEY_SETUP),
+   KEY(KEY_UP), KEY(KEY_DOWN), KEY(KEY_LEFT), KEY(KEY_RIGHT),
+   KEY(KEY_OK), KEY(KEY_SELECT), KEY(KEY_CONNECT), KEY(KEY_WPS_BUTTON),
+   KEY(KEY_PROG1), KEY(KEY_PROG2), KEY(KEY_PROG3), KEY(KEY_PROG4),
+   KEY(KEY_F1), KEY(KEY_F2), KEY(KEY_F3), KEY(KEY_F4),
+   KEY(KEY_VOLUMEUP), KEY(KEY_VOLUMEDOWN), KEY(KEY_MUTE),
+   KEY(KEY_PLAYPAUSE), KEY(KEY_STOP), KEY(KEY_NEXTSONG), KEY(KEY_PREVIOUSSONG)
+};
+
+
+/*********************************************************************
+ * Function:    evdevKeyCode()
+ *
+ * Description: Converts a key name (e.g. BTN_1, KEY_POWER) or number
+ *              to the key code
+ *
+ * Parameters:  name - key name or number
+ *
+ * Return:      key code, -1 if unknown
+ *
+ ********************************************************************/
+int evdevKeyCode(const char *name)
+{
+   char *end;
+   unsigned long code;
+   int i;
+
+   for (i=0; i<sizeof(key_names)/sizeof(key_names[0]); i++) {
+      if (strcmp(key_names[i].name, name) == 0)
+         return key_names[i].code;
+   }
+   code = strtoul(name, &end, 0);
+   if (end == name || *end || code > KEY_MAX)
+      return -1;
+   return code;
+}
+
+
+/*********************************************************************
+ * Function:    evdevSetGrab()
+ *
+ * Description: Sets whether the input devices are grabbed
+ *
+ * Parameters:  grab - 1 to grab the input devices
+ *
+ ********************************************************************/
+void evdevSetGrab(int g)
+{
+   grab = g;
+}
+
+
+static int anyDevice(const DEVICE_t *dev)
+{
+   return (strcmp(dev->path, ANY_DEVICE) == 0);
+}
+
+
+/*********************************************************************
+ * Function:    configured()
+ *
+ * Description: Checks if a device is configured for a button, not only
+ *              opened for the keys on any device
+ *
+ ********************************************************************/
+static int configured(const DEVICE_t *dev)
+{
+   int i;
+
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].dev == dev)
+         return 1;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    hasAnyKey()
+ *
+ * Description: Checks if an input device has one of the keys
+ *              configured on any device
+ *
+ * Parameters:  fd - input device
+ *
+ ********************************************************************/
+static int hasAnyKey(int fd)
+{
+   unsigned long keys[KEY_MAX/BITS_PER_LONG+1];
+   int i;
+
+   memset(keys, 0, sizeof(keys));
+   if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0)
+      return 0;
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].dev->source == &source_evdev && anyDevice(buttons[i].dev) &&
+          TEST_BIT(buttons[i].code, keys))
+         return 1;
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    openDevice()
+ *
+ * Description: Opens an input device, sets the clock of its event
+ *              timestamps and grabs it if requested
+ *
+ * Parameters:  dev - device
+ *
+ * Return:      0 on success, 1 if the device is not present or has
+ *              none of the keys on any device, -1 on error
+ *
+ ********************************************************************/
+static int openDevice(DEVICE_t *dev)
+{
+   int version;
+   unsigned short id[4];
+   char name[256] = "Unknown";
+   int clk = CLOCK_MONOTONIC;
+   int fd;
+
+   fd = open(dev->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+   if (fd < 0) {
+      if (errno == ENOENT || errno == ENODEV || errno == ENXIO)
+         return 1;
+      fprintf(stderr, "Open %s: %s\n", dev->path, strerror(errno));
+      return -1;
+   }
+
+   if (ioctl(fd, EVIOCGVERSION, &version)) {
+      fprintf(stderr, "%s is no input device: %s\n", dev->path, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   if (!configured(dev) && !hasAnyKey(fd)) {
+      close(fd);
+      return 1;
+   }
+
+   ioctl(fd, EVIOCGID, id);
+   ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+   printf("%s: \"%s\", bus 0x%x vendor 0x%x product 0x%x version 0x%x, driver %d.%d.%d\n",
+          dev->path, name, id[ID_BUS], id[ID_VENDOR], id[ID_PRODUCT], id[ID_VERSION],
+          version >> 16, (version >> 8) & 0xff, version & 0xff);
+
+   dev->kernel_time = (ioctl(fd, EVIOCSCLOCKID, &clk) == 0);
+   if (!dev->kernel_time)
+      fprintf(stderr, "%s: no monotonic event timestamps, using time of reading\n", dev->path);
+   if (grab && ioctl(fd, EVIOCGRAB, 1) < 0)
+      fprintf(stderr, "Unable to grab %s: %s\n", dev->path, strerror(errno));
+   fflush(stdout);
+
+   dev->fd = fd;
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function: setup()
+ *
+ * Description: Opens the input device. A device which is not present
+ *              is opened when it appears.
+ *
+ * Parameters: dev - device to set up
+ *
+ ********************************************************************/
+static int setup(DEVICE_t *dev)
+{
+   if (anyDevice(dev))
+      return 0;
+
+   switch (openDevice(dev)) {
+      case 0:
+         return 0;
+      case 1:
+         printf("%s not present, waiting for it\n", dev->path);
+         return 0;
+      default:
+         return 1;
+   }
+}
+
+
+/*********************************************************************
+ * Function:    addPresent()
+ *
+ * Description: Opens the configured devices which are not open yet,
+ *              and a new device in /dev/input if it has one of the
+ *              keys on any device
+ *
+ * Parameters:  name - name of new device in /dev/input, NULL if none
+ *
+ ********************************************************************/
+static void addPresent(const char *name)
+{
+   char path[MAX_NAME_LEN];
+   DEVICE_t *dev = NULL;
+   int i, any=0;
+
+   for (i=0; i<num_devices; i++) {
+      if (devices[i].source != &source_evdev)
+         continue;
+      if (anyDevice(&devices[i]))
+         any = 1;
+      else if (devices[i].fd < 0 && configured(&devices[i]) && openDevice(&devices[i]) == 0 &&
+               watchDevice(&devices[i]) != 0)
+         removeDevice(&devices[i]);
+   }
+
+   if (name == NULL || !any || strncmp(name, "event", 5) != 0)
+      return;
+   snprintf(path, sizeof(path), "%s/%s", INPUT_DIR, name);
+   for (i=0; i<num_devices && dev == NULL; i++) {
+      if (devices[i].source == &source_evdev && strcmp(devices[i].path, path) == 0)
+         dev = &devices[i];
+   }
+
+   if (dev == NULL) {
+      dev = addDevice(&source_evdev, path, 0);
+      if (dev == NULL)
+         return;
+      if (openDevice(dev) != 0) {
+         // slots are kept only for devices with keys
+         num_devices--;
+         return;
+      }
+   }
+   else if (dev->fd >= 0 || openDevice(dev) != 0)
+      return;
+
+   if (watchDevice(dev) != 0)
+      removeDevice(dev);
+}
+
+
+/*********************************************************************
+ * Function:    watch()
+ *
+ * Description: Starts watching /dev/input (and the directories of the
+ *              configured devices, e.g. /dev/input/by-path) for new
+ *              devices and opens the devices present. Called again
+ *              after a reload, the watch is kept and the directories
+ *              and devices of the new configuration are added.
+ *
+ * Return:      inotify fd, -1 on error
+ *
+ ********************************************************************/
+static int watch(void)
+{
+   char dir[MAX_NAME_LEN];
+   struct dirent *d;
+   DIR *dp;
+   int i;
+
+   if (ifd < 0) {
+      ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (ifd < 0) {
+         fprintf(stderr, "inotify_init1() failed: %s\n", strerror(errno));
+         return -1;
+      }
+      if (inotify_add_watch(ifd, INPUT_DIR, IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0)
+         fprintf(stderr, "Unable to watch %s: %s\n", INPUT_DIR, strerror(errno));
+   }
+   for (i=0; i<num_devices; i++) {
+      if (devices[i].source != &source_evdev || anyDevice(&devices[i]))
+         continue;
+      strcpy(dir, devices[i].path);
+      inotify_add_watch(ifd, dirname(dir), IN_CREATE | IN_ATTRIB | IN_MOVED_TO);
+   }
+
+   dp = opendir(INPUT_DIR);
+   if (dp) {
+      while ((d = readdir(dp)) != NULL)
+         addPresent(d->d_name);
+      closedir(dp);
+   }
+   return ifd;
+}
+
+
+/*********************************************************************
+ * Function:    hotplug()
+ *
+ * Description: Handles the inotify events of new devices
+ *
+ ********************************************************************/
+static void hotplug(void)
+{
+   char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+   const struct inotify_event *ev;
+   int n;
+   char *p;
+
+   while ((n = read(ifd, buf, sizeof(buf))) > 0) {
+      for (p=buf; p<buf+n; p+=sizeof(struct inotify_event)+ev->len) {
+         ev = (const struct inotify_event *)p;
+         addPresent(ev->len ? ev->name : NULL);
+      }
+   }
+}
+
+
+/*********************************************************************
+ * Function:    resync()
+ *
+ * Description: Reads back the key states after events were dropped
+ *
+ * Parameters:  dev - device
+ *
+ ********************************************************************/
+static void resync(DEVICE_t *dev)
+{
+   unsigned long keys[KEY_MAX/BITS_PER_LONG+1];
+   uint64_t now = btnMillis();
+   int i;
+
+   fprintf(stderr, "%s: events dropped\n", dev->path);
+   memset(keys, 0, sizeof(keys));
+   if (ioctl(dev->fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+      return;
+   for (i=0; i<num_buttons; i++) {
+      if (buttons[i].dev == dev || (buttons[i].dev->source == &source_evdev && anyDevice(buttons[i].dev)))
+         buttonEvent(dev, buttons[i].code, TEST_BIT(buttons[i].code, keys), now);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    readEvents()
+ *
+ * Description: Reads the queued events of the input device and passes
+ *              on the key presses and releases (not the autorepeat)
+ *
+ * Parameters:  dev - device
+ *
+ ********************************************************************/
+static void readEvents(DEVICE_t *dev)
+{
+   struct input_event ev[MAX_INPUT_EVENTS];
+   uint64_t time;
+   int n, i, dropped=0;
+
+   n = read(dev->fd, ev, sizeof(ev));
+   if (n < 0 && errno == EAGAIN)
+      return;
+   if (n < (int)sizeof(ev[0])) {
+      if (n < 0 && errno == ENODEV)
+         removeDevice(dev);
+      else
+         fprintf(stderr, "Unable to read from %s: %s\n", dev->path,
+                 n < 0 ? strerror(errno) : "short read");
+      return;
+   }
+
+   for (i=0; i<n/(int)sizeof(ev[0]); i++) {
+      if (ev[i].type == EV_SYN && ev[i].code == SYN_DROPPED) {
+         // ignore the events up to the next report, then read the state
+         dropped = 1;
+      }
+      else if (dropped) {
+         if (ev[i].type == EV_SYN && ev[i].code == SYN_REPORT) {
+            dropped = 0;
+            resync(dev);
+         }
+      }
+      else if (ev[i].type == EV_KEY && (ev[i].value == 0 || ev[i].value == 1)) {
+         time = (dev->kernel_time ? (uint64_t)ev[i].input_event_sec*1000 +
+                                    ev[i].input_event_usec/1000 : btnMillis());
+         buttonEvent(dev, ev[i].code, ev[i].value, time);
+      }
+   }
+   if (dropped)
+      resync(dev);
+}
+
+
+/*********************************************************************
+ * Function:    cleanup()
+ *
+ * Description: Closes the input device
+ *
+ * Parameters: dev - device to clean up
+ *
+ ********************************************************************/
+static void cleanup(DEVICE_t *dev)
+{
+   if (dev->fd >= 0)
+      close(dev->fd);
+   dev->fd = -1;
+}
+
+
+const SOURCE_t source_evdev = {
+   .name = "evdev",
+   .epoll_events = EPOLLIN,
+   .setup = setup,
+   .read = readEvents,
+   .cleanup = cleanup,
+   .watch = watch,
+   .hotplug = hotplug
+};
@@ -0,0 +1,152 @@
+/*
+ *  Filename: src_gpiochip.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Input source for push buttons connected to GPIO lines, used via
+ *  the GPIO character device (uAPI v2, Linux 5.10 or later).
+ *
+ *  The line is requested as input with edge detection on both edges.
+ *  The kernel debounces it, so a bouncing contact results in one event
+ *  per real transition, and timestamps the edges. All events queued on
+ *  the line request are read at once.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#include "buttond.h"
+
+/* debounce period (ms) */
+#define DEBOUNCE_TIME 10
+
+/* max number of line events read at once */
+#define MAX_LINE_EVENTS 16
+
+
+/*********************************************************************
+ * Function: setup()
+ *
+ * Description: Requests the GPIO line from its chip as input with
+ *              edge detection on both edges and debouncing. The line
+ *              request fd stays open until cleanup().
+ *
+ * Parameters: dev - device to set up
+ *
+ ********************************************************************/
+static int setup(DEVICE_t *dev)
+{
+   struct gpio_v2_line_request req;
+   int fd;
+
+   fd = open(dev->path, O_RDONLY | O_CLOEXEC);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", dev->path, strerror(errno));
+      return 1;
+   }
+
+   // Edge timestamps are CLOCK_MONOTONIC, as used by the gesture engine
+   memset(&req, 0, sizeof(req));
+   req.offsets[0] = dev->line;
+   req.num_lines = 1;
+   strcpy(req.consumer, NAME);
+   req.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+                      GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+   req.config.num_attrs = 1;
+   req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+   req.config.attrs[0].attr.debounce_period_us = DEBOUNCE_TIME*1000;
+   req.config.attrs[0].mask = 1;
+   req.event_buffer_size = MAX_LINE_EVENTS;
+
+   if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+      fprintf(stderr, "Unable to request line %u of %s (already in use?): %s\n",
+              dev->line, dev->path, strerror(errno));
+      close(fd);
+      return 2;
+   }
+   close(fd);
+   dev->fd = req.fd;
+
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    readEvents()
+ *
+ * Description: Reads the edge events queued on the line request, the
+ *              durations are taken from the kernel timestamps of the
+ *              edges
+ *
+ * Parameters:  dev - device
+ *
+ ********************************************************************/
+static void readEvents(DEVICE_t *dev)
+{
+   struct gpio_v2_line_event ev[MAX_LINE_EVENTS];
+   int n, i;
+
+   n = read(dev->fd, ev, sizeof(ev));
+   if (n < (int)sizeof(ev[0])) {
+      fprintf(stderr, "Unable to read line events of %s:%u: %s\n", dev->path, dev->line,
+              n < 0 ? strerror(errno) : "short read");
+      return;
+   }
+
+   // Pressed button pulls the line low
+   for (i=0; i<n/(int)sizeof(ev[0]); i++) {
+      buttonEvent(dev, 0, ev[i].id == GPIO_V2_LINE_EVENT_FALLING_EDGE,
+                  ev[i].timestamp_ns/1000000);
+   }
+}
+
+
+/*********************************************************************
+ * Function:    cleanup()
+ *
+ * Description: Releases the line by closing its request
+ *
+ * Parameters: dev - device to clean up
+ *
+ ********************************************************************/
+static void cleanup(DEVICE_t *dev)
+{
+   if (dev->fd >= 0)
+      close(dev->fd);
+   dev->fd = -1;
+}
+
+
+const SOURCE_t source_gpiochip = {
+   .name = "gpiochip",
+   .epoll_events = EPOLLIN,
+   .setup = setup,
+   .read = readEvents,
+   .cleanup = cleanup
+};
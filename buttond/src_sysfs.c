@@ -0,0 +1,215 @@
+/*
+ *  Filename: src_sysfs.c
+ *
+ *  Author: Ondrej Wisniewski
+ *
+ *  Description:
+ *  Input source for push buttons connected to GPIO lines, used via
+ *  the sysfs GPIO interface.
+ *
+ *  The pin is exported and its value file opened once at setup. Edges
+ *  are reported by epoll as EPOLLPRI, after which the value is read
+ *  back from the file.
+ *
+ */
+
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+#include "buttond.h"
+
+#define GPIO_BASE_DIR "/sys/class/gpio"
+#define EXPORT_FILE "/sys/class/gpio/export"
+#define UNEXPORT_FILE "/sys/class/gpio/unexport"
+
+typedef enum {
+   LOW,
+   HIGH
+}
+PIN_STATE_t;
+
+
+static void sysfs_filename(char *filename, int len, int pin, const char *function)
+{
+   // Generic naming, AT91 kernels name the pins after the PIO controller
+   snprintf(filename, len, "%s/gpio%d", GPIO_BASE_DIR, pin);
+   if (access(filename, F_OK) == 0)
+      snprintf(filename, len, "%s/gpio%d/%s", GPIO_BASE_DIR, pin, function);
+   else
+      snprintf(filename, len, "%s/pio%c%d/%s", GPIO_BASE_DIR, 'A'+pin/32, pin%32, function);
+}
+
+
+/*********************************************************************
+ * Function: digitalRead()
+ *
+ * Description: Read from the data pin
+ *
+ * Parameters: fd - file descriptor of GPIO sysfs value file
+ *
+ ********************************************************************/
+static PIN_STATE_t digitalRead(int fd)
+{
+   char d[1] = { '1' };
+   if (pread(fd, d, 1, 0) != 1) {
+      fprintf(stderr, "Unable to pread gpio value: %s\n",
+              strerror(errno));
+   }
+   return (d[0] == '0' ? LOW : HIGH);
+}
+
+
+/*********************************************************************
+ * Function: setup()
+ *
+ * Description: Exports the GPIO pin and opens its value file, which
+ *              stays open until cleanup()
+ *
+ * Parameters: dev - device to set up
+ *
+ ********************************************************************/
+static int setup(DEVICE_t *dev)
+{
+   int fd;
+   char b[64];
+   int pin = dev->line;
+
+   // Prepare GPIO pin connected to the push button to be used with GPIO sysfs
+   // (export to user space)
+   fd = open(EXPORT_FILE, O_WRONLY);
+   if (fd < 0) {
+      perror(EXPORT_FILE);
+      return 1;
+   }
+   snprintf(b, sizeof(b), "%d", pin);
+   if (pwrite(fd, b, strlen(b), 0) < 0) {
+      fprintf(stderr, "Unable to export pin=%d (already in use?): %s\n",
+              pin, strerror(errno));
+      close(fd);
+      return 2;
+   }
+   close(fd);
+
+   // Define edge interrupt (both edge)
+   // to be used later with epoll for edge detection
+   sysfs_filename(b, sizeof(b), pin, "edge");
+   fd = open(b, O_RDWR);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+      return 3;
+   }
+   if (pwrite(fd, "both", 4, 0) < 0) {
+      fprintf(stderr, "Unable to write 'both' to %s: %s\n",
+             b, strerror(errno));
+      close(fd);
+      return 4;
+   }
+   close(fd);
+
+   // Define gpio direction as input
+   sysfs_filename(b, sizeof(b), pin, "direction");
+   fd = open(b, O_RDWR);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+      return 5;
+   }
+   if (pwrite(fd, "in", 2, 0) < 0) {
+      fprintf(stderr, "Unable to write 'in' to %s: %s\n",
+             b, strerror(errno));
+      close(fd);
+      return 6;
+   }
+   close(fd);
+
+   // Open gpio value file for reading, kept open for all edges
+   sysfs_filename(b, sizeof(b), pin, "value");
+   dev->fd = open(b, O_RDONLY | O_CLOEXEC);
+   if (dev->fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+      return 7;
+   }
+
+   // Read the current value, so only new edges are reported
+   digitalRead(dev->fd);
+
+   return 0;
+}
+
+
+/*********************************************************************
+ * Function:    readEdge()
+ *
+ * Description: Handles an edge change on the GPIO pin
+ *
+ * Parameters:  dev - device
+ *
+ ********************************************************************/
+static void readEdge(DEVICE_t *dev)
+{
+   // Pressed button pulls the line low
+   buttonEvent(dev, 0, digitalRead(dev->fd) == LOW, btnMillis());
+}
+
+
+/*********************************************************************
+ * Function:    cleanup()
+ *
+ * Description: Closes the value file and unexports the GPIO pin
+ *
+ * Parameters: dev - device to clean up
+ *
+ ********************************************************************/
+static void cleanup(DEVICE_t *dev)
+{
+   int fd;
+   char b[16];
+
+   if (dev->fd < 0)
+      return;
+   close(dev->fd);
+   dev->fd = -1;
+
+   // Free GPIO pin (unexport)
+   fd = open(UNEXPORT_FILE, O_WRONLY);
+   if (fd < 0) {
+      perror(UNEXPORT_FILE);
+      return;
+   }
+   snprintf(b, sizeof(b), "%u", dev->line);
+   if (pwrite(fd, b, strlen(b), 0) < 0) {
+      fprintf(stderr,  "Unable to unexport pin=%u: %s\n",
+              dev->line, strerror(errno));
+   }
+   close(fd);
+}
+
+
+const SOURCE_t source_sysfs = {
+   .name = "sysfs",
+   .epoll_events = EPOLLPRI | EPOLLERR,
+   .setup = setup,
+   .read = readEdge,
+   .cleanup = cleanup
+};
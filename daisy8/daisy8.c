@@ -0,0 +1,459 @@
+/************************************************************************
+
+  This file is part of the Daisy8 relay and input module library.
+
+  This is the implementation of the relay and input functions using
+  the GPIO character device.
+
+  Author: Ondrej Wisniewski
+
+  The Daisy pins are given by their Kernel Id in the 2.6 series. The
+  AT91 GPIO numbering then started at 32 (PA0 = 32, PB0 = 64), from
+  the 3.x series on it starts at 0. On the GPIO character device the
+  line of a pin is found by its name (pioA31 for PA31, given by the
+  AT91 pinctrl driver), else line <pin> of gpiochip<bank> is used.
+
+  All relays of a connector are on the same GPIO chip, so they are
+  requested together and switched with one GPIO_V2_LINE_SET_VALUES
+  ioctl. The inputs are read with one GPIO_V2_LINE_GET_VALUES ioctl
+  per GPIO chip (only the inputs of D2 are on two chips, PA and PB).
+
+  Changelog:
+   19-09-2013: Initial version (daisy8.sh shell script)
+   18-10-2026: Rewritten as C library, using the GPIO character device
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/utsname.h>
+#include <linux/gpio.h>
+
+#include "daisy8.h"
+
+#define GPIO_CHIP_DEV  "/dev/gpiochip%d"
+#define MAX_GPIOCHIPS  16
+#define CONSUMER       "daisy8"
+
+// First Kernel Id of the AT91 GPIOs in the 2.6 series
+#define PIN_BASE_26    32
+
+// GPIO Kernel Ids of the Daisy pins 2..9, valid for Kernel 2.6.xx series
+// See http://www.acmesystems.it/DAISY-1
+static const int16_t pin_table[][8] = {
+   { 63, 62, 61, 60, 59, 58, 57, 94 },   // D2 on FoxG20
+   { 76, 77, 80, 81, 82, 83, 84, 85 },   // D5 on FoxG20
+   { 65, 64, 66, 67, -1, -1, -1, -1 }    // D11 on FoxG20 V2
+};
+
+// Daisy pins of the relays and inputs (the second module is connected
+// to pins 6..9)
+static const uint8_t relay_pins[DAISY8_MAX_RELAYS] = { 2, 3, 6, 7 };
+static const uint8_t input_pins[DAISY8_MAX_INPUTS] = { 4, 5, 8, 9 };
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    kernel26()
+ *
+ * Description: Checks if the running kernel uses the GPIO numbering of
+ *              the 2.6 series
+ *
+ ********************************************************************/
+static int kernel26(void)
+{
+   struct utsname u;
+
+   return (uname(&u) == 0 && strncmp(u.release, "2.", 2) == 0);
+}
+
+/*********************************************************************
+ * Function:    findLine()
+ *
+ * Description: Finds the GPIO chip and line of a Daisy pin
+ *
+ * Parameters:  id     - Kernel Id of the pin (2.6 series)
+ *              chip   - (out) GPIO chip number
+ *              offset - (out) line offset on the chip
+ *
+ ********************************************************************/
+static void findLine(int id, int *chip, uint32_t *offset)
+{
+   struct gpiochip_info info;
+   struct gpio_v2_line_info line;
+   char name[16], path[32];
+   int bank = (id - PIN_BASE_26) / 32;
+   int pin = (id - PIN_BASE_26) % 32;
+   int i, fd;
+   uint32_t j;
+
+   snprintf(name, sizeof(name), "pio%c%d", 'A' + bank, pin);
+   for (i=0; i<MAX_GPIOCHIPS; i++) {
+      snprintf(path, sizeof(path), GPIO_CHIP_DEV, i);
+      fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         continue;
+      if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) == 0) {
+         for (j=0; j<info.lines; j++) {
+            memset(&line, 0, sizeof(line));
+            line.offset = j;
+            if (ioctl(fd, GPIO_V2_GET_LINEINFO_IOCTL, &line) == 0 &&
+                strcmp(line.name, name) == 0) {
+               close(fd);
+               *chip = i;
+               *offset = j;
+               return;
+            }
+         }
+      }
+      close(fd);
+   }
+
+   // unnamed lines: one chip per PIO bank
+   *chip = bank;
+   *offset = pin;
+}
+
+/*********************************************************************
+ * Function:    requestLines()
+ *
+ * Description: Requests lines of a GPIO chip as inputs or outputs.
+ *              Outputs which are already outputs keep their value,
+ *              the others are set low.
+ *
+ * Parameters:  req     - request, fd is set
+ *              chip    - GPIO chip number
+ *              offsets - line offsets
+ *              output  - 1 for outputs
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int requestLines(DAISY8_REQUEST_t *req, int chip, const uint32_t *offsets, int output)
+{
+   struct gpio_v2_line_request r;
+   struct gpio_v2_line_info info;
+   char path[32];
+   uint64_t set_out = 0;
+   int i, fd, err;
+
+   snprintf(path, sizeof(path), GPIO_CHIP_DEV, chip);
+   fd = open(path, O_RDONLY | O_CLOEXEC);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", path, strerror(errno));
+      return -1;
+   }
+
+   memset(&r, 0, sizeof(r));
+   memcpy(r.offsets, offsets, req->num_lines * sizeof(uint32_t));
+   r.num_lines = req->num_lines;
+   strcpy(r.consumer, CONSUMER);
+   if (output) {
+      // no direction flag: lines keep their direction (and value),
+      // lines which are no outputs yet are switched to low outputs
+      for (i=0; i<req->num_lines; i++) {
+         memset(&info, 0, sizeof(info));
+         info.offset = offsets[i];
+         if (ioctl(fd, GPIO_V2_GET_LINEINFO_IOCTL, &info) < 0 ||
+             !(info.flags & GPIO_V2_LINE_FLAG_OUTPUT))
+            set_out |= 1ULL << i;
+      }
+      if (set_out) {
+         r.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_FLAGS;
+         r.config.attrs[0].attr.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+         r.config.attrs[0].mask = set_out;
+         r.config.attrs[1].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+         r.config.attrs[1].attr.values = 0;
+         r.config.attrs[1].mask = set_out;
+         r.config.num_attrs = 2;
+      }
+   }
+   else
+      r.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+
+   if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &r) < 0) {
+      err = errno;
+      fprintf(stderr, "Unable to request lines of %s (already in use?): %s\n",
+              path, strerror(err));
+      close(fd);
+      errno = err;
+      return -1;
+   }
+   close(fd);
+   req->fd = r.fd;
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    setupRequests()
+ *
+ * Description: Groups the lines of the relays or inputs by GPIO chip
+ *              and requests them
+ *
+ * Parameters:  req    - requests
+ *              table  - Kernel Ids of the Daisy pins of the connector
+ *              pins   - Daisy pin of each relay or input
+ *              num    - number of relays or inputs
+ *              output - 1 for outputs
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int setupRequests(DAISY8_REQUEST_t *req, const int16_t *table,
+                         const uint8_t *pins, int num, int output)
+{
+   uint32_t offsets[DAISY8_MAX_CHIPS][DAISY8_MAX_RELAYS];
+   int chips[DAISY8_MAX_CHIPS];
+   int num_chips = 0;
+   int n, i, chip;
+   uint32_t offset;
+
+   for (n=0; n<num; n++) {
+      findLine(table[pins[n]-2], &chip, &offset);
+      for (i=0; i<num_chips && chips[i] != chip; i++);
+      if (i == DAISY8_MAX_CHIPS) {
+         errno = EINVAL;
+         return -1;
+      }
+      if (i == num_chips)
+         chips[num_chips++] = chip;
+      offsets[i][req[i].num_lines] = offset;
+      req[i].bit[req[i].num_lines++] = n;
+   }
+
+   for (i=0; i<num_chips; i++) {
+      if (requestLines(&req[i], chips[i], offsets[i], output) < 0)
+         return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    getValues()
+ *
+ * Description: Reads the lines of requests into a bitmask
+ *
+ ********************************************************************/
+static int getValues(const DAISY8_REQUEST_t *req, uint8_t *values)
+{
+   struct gpio_v2_line_values v;
+   int i, j;
+
+   *values = 0;
+   for (i=0; i<DAISY8_MAX_CHIPS && req[i].fd >= 0; i++) {
+      v.bits = 0;
+      v.mask = (1ULL << req[i].num_lines) - 1;
+      if (ioctl(req[i].fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) < 0)
+         return -1;
+      for (j=0; j<req[i].num_lines; j++) {
+         if (v.bits & (1ULL << j))
+            *values |= 1 << req[i].bit[j];
+      }
+   }
+   return 0;
+}
+
+
+/*********************************************************************
+ * API FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    daisy8Connector()
+ *
+ * Description: Converts the name of a Daisy connector
+ *
+ * Parameters:  name - d2, d5 or d11
+ *
+ * Return:      connector, -1 if the name is invalid
+ *
+ ********************************************************************/
+int daisy8Connector(const char *name)
+{
+   if (strcasecmp(name, "d2") == 0)
+      return DAISY8_D2;
+   if (strcasecmp(name, "d5") == 0)
+      return DAISY8_D5;
+   if (strcasecmp(name, "d11") == 0)
+      return DAISY8_D11;
+   return -1;
+}
+
+/*********************************************************************
+ * Function:    daisy8Gpio()
+ *
+ * Description: Returns the Kernel Id of the GPIO line of a Daisy pin
+ *              for the running kernel (numbering of the 2.6 series,
+ *              or of the 3.x series and later), e.g. for the sysfs
+ *              GPIO interface
+ *
+ * Parameters:  connector - Daisy connector
+ *              pin       - Daisy pin (2..9)
+ *
+ * Return:      Kernel Id, -1 if the pin is not available
+ *
+ ********************************************************************/
+int daisy8Gpio(DAISY8_CONNECTOR_t connector, int pin)
+{
+   int id;
+
+   if (connector > DAISY8_D11 || pin < 2 || pin > 9)
+      return -1;
+   id = pin_table[connector][pin-2];
+   if (id < 0 || kernel26())
+      return id;
+   return id - PIN_BASE_26;
+}
+
+/*********************************************************************
+ * Function:    daisy8Open()
+ *
+ * Description: Requests the GPIO lines of the Daisy8 modules on a
+ *              connector. The lines stay requested until daisy8Close().
+ *              Relays which are already switched by an output keep
+ *              their state, the others are switched off.
+ *
+ * Parameters:  d8        - (out) modules
+ *              connector - Daisy connector
+ *              modules   - number of chained modules (1 or 2, D11: 1)
+ *
+ * Return:      0 on success, -1 on error (errno is set)
+ *
+ ********************************************************************/
+int daisy8Open(DAISY8_t *d8, DAISY8_CONNECTOR_t connector, int modules)
+{
+   const int16_t *table;
+   int i, err;
+
+   if (connector > DAISY8_D11 || modules < 1 || modules > 2 ||
+       (connector == DAISY8_D11 && modules > 1)) {
+      errno = EINVAL;
+      return -1;
+   }
+
+   memset(d8, 0, sizeof(DAISY8_t));
+   d8->connector = connector;
+   d8->modules = modules;
+   d8->num_relays = 2 * modules;
+   d8->num_inputs = 2 * modules;
+   for (i=0; i<DAISY8_MAX_CHIPS; i++) {
+      d8->relays[i].fd = -1;
+      d8->inputs[i].fd = -1;
+   }
+
+   table = pin_table[connector];
+   if (setupRequests(d8->relays, table, relay_pins, d8->num_relays, 1) < 0 ||
+       setupRequests(d8->inputs, table, input_pins, d8->num_inputs, 0) < 0) {
+      err = errno;
+      daisy8Close(d8);
+      errno = err;
+      return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    daisy8SetRelays()
+ *
+ * Description: Switches several relays at once. The relays of one GPIO
+ *              chip (all relays of a connector) are set with one ioctl,
+ *              so they switch at the same time.
+ *
+ * Parameters:  d8     - modules
+ *              mask   - relays to switch (bit n: relay n)
+ *              values - new state of the relays (bit n: 1 = on)
+ *
+ * Return:      0 on success, -1 on error (errno is set)
+ *
+ ********************************************************************/
+int daisy8SetRelays(DAISY8_t *d8, uint8_t mask, uint8_t values)
+{
+   struct gpio_v2_line_values v;
+   DAISY8_REQUEST_t *req;
+   int i, j;
+
+   if (mask >> d8->num_relays) {
+      errno = EINVAL;
+      return -1;
+   }
+
+   for (i=0; i<DAISY8_MAX_CHIPS && d8->relays[i].fd >= 0; i++) {
+      req = &d8->relays[i];
+      v.bits = 0;
+      v.mask = 0;
+      for (j=0; j<req->num_lines; j++) {
+         if (mask & (1 << req->bit[j])) {
+            v.mask |= 1ULL << j;
+            if (values & (1 << req->bit[j]))
+               v.bits |= 1ULL << j;
+         }
+      }
+      if (v.mask && ioctl(req->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0)
+         return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    daisy8GetRelays()
+ *
+ * Description: Reads the state of all relays
+ *
+ * Parameters:  d8     - modules
+ *              values - (out) state of the relays (bit n: 1 = on)
+ *
+ * Return:      0 on success, -1 on error (errno is set)
+ *
+ ********************************************************************/
+int daisy8GetRelays(DAISY8_t *d8, uint8_t *values)
+{
+   return getValues(d8->relays, values);
+}
+
+/*********************************************************************
+ * Function:    daisy8ReadInputs()
+ *
+ * Description: Reads a snapshot of all inputs, with one ioctl per GPIO
+ *              chip
+ *
+ * Parameters:  d8     - modules
+ *              values - (out) line level of the inputs (bit n: input n)
+ *
+ * Return:      0 on success, -1 on error (errno is set)
+ *
+ ********************************************************************/
+int daisy8ReadInputs(DAISY8_t *d8, uint8_t *values)
+{
+   return getValues(d8->inputs, values);
+}
+
+/*********************************************************************
+ * Function:    daisy8Close()
+ *
+ * Description: Releases the GPIO lines. The relays keep their state.
+ *
+ * Parameters:  d8 - modules
+ *
+ ********************************************************************/
+void daisy8Close(DAISY8_t *d8)
+{
+   int i;
+
+   for (i=0; i<DAISY8_MAX_CHIPS; i++) {
+      if (d8->relays[i].fd >= 0)
+         close(d8->relays[i].fd);
+      if (d8->inputs[i].fd >= 0)
+         close(d8->inputs[i].fd);
+      d8->relays[i].fd = -1;
+      d8->inputs[i].fd = -1;
+   }
+}
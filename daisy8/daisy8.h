@@ -0,0 +1,73 @@
+/************************************************************************
+  Daisy8 relay and input module library for use on the FoxG20 embedded
+  Linux board (by ACME Systems).
+
+  Author: Ondrej Wisniewski
+
+  Module description: http://www.acmesystems.it/DAISY-8
+
+  One or two chained Daisy8 modules on the D2 or D5 Daisy connector,
+  one module on the D11 connector (FoxG20 V2) are supported:
+
+    relay 0..3: Daisy pins 2, 3, 6, 7 (relays 2, 3 on the second module)
+    input 0..3: Daisy pins 4, 5, 8, 9 (inputs 2, 3 on the second module)
+
+  The GPIO lines are used via the GPIO character device (Linux 5.10 or
+  later). They are requested once by daisy8Open() and kept until
+  daisy8Close(), so switching the relays and reading the inputs costs
+  one ioctl each.
+
+  Changelog:
+   19-09-2013: Initial version (daisy8.sh shell script)
+   18-10-2026: Rewritten as C library, using the GPIO character device
+
+ ******************************************************************/
+
+#ifndef daisy8_h
+#define daisy8_h
+
+#include <stdint.h>
+
+// Number of relays and inputs of two chained modules
+#define DAISY8_MAX_RELAYS 4
+#define DAISY8_MAX_INPUTS 4
+
+// Max number of GPIO chips the lines of a connector are spread over
+#define DAISY8_MAX_CHIPS 2
+
+typedef enum {
+   DAISY8_D2,
+   DAISY8_D5,
+   DAISY8_D11
+}
+DAISY8_CONNECTOR_t;
+
+/* Line request of the relays or inputs on one GPIO chip */
+typedef struct {
+   int fd;                          // -1 if not used
+   uint8_t num_lines;
+   uint8_t bit[DAISY8_MAX_RELAYS];  // relay or input number of each line
+}
+DAISY8_REQUEST_t;
+
+/* Daisy8 modules on a connector */
+typedef struct {
+   DAISY8_CONNECTOR_t connector;
+   uint8_t modules;                 // number of chained modules (1 or 2)
+   uint8_t num_relays;
+   uint8_t num_inputs;
+   DAISY8_REQUEST_t relays[DAISY8_MAX_CHIPS];
+   DAISY8_REQUEST_t inputs[DAISY8_MAX_CHIPS];
+}
+DAISY8_t;
+
+
+int  daisy8Connector(const char *name);
+int  daisy8Gpio(DAISY8_CONNECTOR_t connector, int pin);
+int  daisy8Open(DAISY8_t *d8, DAISY8_CONNECTOR_t connector, int modules);
+int  daisy8SetRelays(DAISY8_t *d8, uint8_t mask, uint8_t values);
+int  daisy8GetRelays(DAISY8_t *d8, uint8_t *values);
+int  daisy8ReadInputs(DAISY8_t *d8, uint8_t *values);
+void daisy8Close(DAISY8_t *d8);
+
+#endif /*daisy8_h*/
@@ -0,0 +1,270 @@
+/************************************************************************
+  daisy8 - Control the relays and read the inputs of the Daisy8 module
+  on the FoxG20 embedded Linux board (by ACME Systems). Replaces the
+  daisy8.sh script, with the same command line for single relays and
+  inputs:
+
+    daisy8 d2 rl0 on
+    daisy8 d2 in1
+
+  Several relays given as rl<n>=on|off are switched at the same time,
+  all inputs are read at once as bitmask (bit n: input n):
+
+    daisy8 d5 rl0=on rl1=off in
+
+  With - the commands are read from stdin, one line each, and the GPIO
+  lines stay requested between them:
+
+    printf 'rl0=on rl1=on\nin\nrl0=off rl1=off\n' | daisy8 d2 -
+
+  Author: Ondrej Wisniewski
+
+  Build command:
+  make
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "daisy8.h"
+
+#define MAX_LINE 256
+#define MAX_ARGS 32
+
+
+/*********************************************************************
+ * Function:    item()
+ *
+ * Description: Parses a relay (rl<n>) or input (in<n>) name
+ *
+ * Parameters:  arg    - argument
+ *              prefix - rl or in
+ *              end    - (out) character after the number
+ *
+ * Return:      relay or input number, -1 if the argument is no such
+ *              name
+ *
+ ********************************************************************/
+static int item(const char *arg, const char *prefix, const char **end)
+{
+   if (strncmp(arg, prefix, 2) != 0 || arg[2] < '0' || arg[2] >= '0' + DAISY8_MAX_RELAYS)
+      return -1;
+   *end = arg + 3;
+   return arg[2] - '0';
+}
+
+/*********************************************************************
+ * Function:    modulesNeeded()
+ *
+ * Description: Returns the number of modules used by the commands
+ *
+ ********************************************************************/
+static int modulesNeeded(int argc, char *argv[])
+{
+   const char *end;
+   int i, modules = 1;
+
+   for (i=0; i<argc; i++) {
+      if (item(argv[i], "rl", &end) >= 2 || item(argv[i], "in", &end) >= 2)
+         modules = 2;
+   }
+   return modules;
+}
+
+static int isState(const char *arg)
+{
+   return (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0);
+}
+
+/*********************************************************************
+ * Function:    run()
+ *
+ * Description: Runs the commands of one command line. The relays are
+ *              switched together, then the states are printed.
+ *
+ * Parameters:  d8   - modules
+ *              argc - number of commands
+ *              argv - commands
+ *
+ * Return:      0 on success, 2 if a command is invalid, 3 on GPIO
+ *              error
+ *
+ ********************************************************************/
+static int run(DAISY8_t *d8, int argc, char *argv[])
+{
+   struct {
+      char kind;        // 'r' relays, 'i' inputs
+      int n;            // relay or input number, -1 for all
+   } reads[MAX_ARGS];
+   const char *end, *state;
+   uint8_t mask = 0, values = 0, v;
+   int i, n, num_reads = 0;
+
+   for (i=0; i<argc; i++) {
+      if (num_reads == MAX_ARGS) {
+         fprintf(stderr, "ERROR: too many commands\n");
+         return 2;
+      }
+      if (strcmp(argv[i], "in") == 0 || strcmp(argv[i], "rl") == 0) {
+         reads[num_reads].kind = argv[i][0];
+         reads[num_reads++].n = -1;
+      }
+      else if ((n = item(argv[i], "in", &end)) >= 0 && *end == 0) {
+         if (n >= d8->num_inputs)
+            goto unavailable;
+         reads[num_reads].kind = 'i';
+         reads[num_reads++].n = n;
+      }
+      else if ((n = item(argv[i], "rl", &end)) >= 0 && (*end == 0 || *end == '=')) {
+         if (n >= d8->num_relays)
+            goto unavailable;
+         if (*end == '=')
+            state = end + 1;
+         else if (i+1 < argc && isState(argv[i+1]))
+            state = argv[++i];
+         else {
+            reads[num_reads].kind = 'r';
+            reads[num_reads++].n = n;
+            continue;
+         }
+         if (!isState(state)) {
+            fprintf(stderr, "ERROR: wrong action for %.3s, specify \"on\" or \"off\"\n", argv[i]);
+            return 2;
+         }
+         mask |= 1 << n;
+         if (strcmp(state, "on") == 0)
+            values |= 1 << n;
+         else
+            values &= ~(1 << n);
+      }
+      else {
+         fprintf(stderr, "ERROR: wrong command \"%s\"\n", argv[i]);
+         return 2;
+      }
+   }
+
+   if (mask && daisy8SetRelays(d8, mask, values) < 0) {
+      fprintf(stderr, "ERROR: unable to switch the relays: %s\n", strerror(errno));
+      return 3;
+   }
+
+   for (i=0; i<num_reads; i++) {
+      if ((reads[i].kind == 'i' ? daisy8ReadInputs(d8, &v) : daisy8GetRelays(d8, &v)) < 0) {
+         fprintf(stderr, "ERROR: unable to read the %s: %s\n",
+                 reads[i].kind == 'i' ? "inputs" : "relays", strerror(errno));
+         return 3;
+      }
+      if (reads[i].n < 0)
+         printf("0x%02x\n", v);
+      else
+         printf("%d\n", (v >> reads[i].n) & 1);
+   }
+   fflush(stdout);
+   return 0;
+
+unavailable:
+   fprintf(stderr, "ERROR: %s is not available%s\n", argv[i],
+           d8->modules == 1 && d8->connector != DAISY8_D11 ? " (second module: -2)" : "");
+   return 2;
+}
+
+/*********************************************************************
+ * Function:    runStdin()
+ *
+ * Description: Runs the command lines read from stdin
+ *
+ * Return:      0 on success, result of the first failed line otherwise
+ *
+ ********************************************************************/
+static int runStdin(DAISY8_t *d8)
+{
+   char line[MAX_LINE];
+   char *argv[MAX_ARGS];
+   int argc, res, ret = 0;
+
+   while (fgets(line, sizeof(line), stdin) != NULL) {
+      argc = 0;
+      for (argv[0]=strtok(line, " \t\r\n"); argv[argc] && argc < MAX_ARGS-1; argv[++argc]=strtok(NULL, " \t\r\n"));
+      if (argc == 0 || argv[0][0] == '#')
+         continue;
+      res = run(d8, argc, argv);
+      if (res && ret == 0)
+         ret = res;
+   }
+   return ret;
+}
+
+static void usage(void)
+{
+   printf("Control up to 2 Daisy8 modules\n");
+   printf("  Usage:\n");
+   printf("  daisy8 [-2] <Daisy connector> <command> ...\n");
+   printf("  daisy8 [-2] <Daisy connector> -\n");
+   printf("     Daisy connector:  d2|d5|d11\n");
+   printf("     Commands:\n");
+   printf("       rl<n> on|off    switch relay n (0..3)\n");
+   printf("       rl<n>=on|off    switch relay n, all relays are switched at the same time\n");
+   printf("       rl<n>, in<n>    print the state of relay n, of input n (0..3)\n");
+   printf("       rl, in          print the state of all relays, of all inputs as bitmask\n");
+   printf("       gpio            print the Kernel Ids of the Daisy pins 2..9\n");
+   printf("     -                 read the commands from stdin, one line each\n");
+   printf("     -2                second Daisy8 module connected (relays and inputs 2, 3)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+   DAISY8_t d8;
+   int connector, modules = 1;
+   int i, id, ret;
+
+   if (argc > 1 && strcmp(argv[1], "-2") == 0) {
+      modules = 2;
+      argc--;
+      argv++;
+   }
+   if (argc < 3) {
+      usage();
+      return 2;
+   }
+
+   connector = daisy8Connector(argv[1]);
+   if (connector < 0) {
+      fprintf(stderr, "ERROR: wrong Daisy connector number, specify \"d2\", \"d5\" or \"d11\"\n");
+      return 2;
+   }
+
+   if (strcmp(argv[2], "gpio") == 0) {
+      for (i=2; i<=9; i++) {
+         id = daisy8Gpio(connector, i);
+         if (id >= 0)
+            printf("P%d %d\n", i, id);
+      }
+      return 0;
+   }
+
+   if (strcmp(argv[2], "-") != 0 && modulesNeeded(argc-2, argv+2) > modules)
+      modules = 2;
+   if (connector == DAISY8_D11 && modules > 1) {
+      fprintf(stderr, "ERROR: only one Daisy8 module on d11\n");
+      return 2;
+   }
+
+   if (daisy8Open(&d8, connector, modules) < 0) {
+      fprintf(stderr, "ERROR: unable to set up the GPIO lines of %s, check Kernel configuration: %s\n",
+              argv[1], strerror(errno));
+      return 3;
+   }
+
+   if (strcmp(argv[2], "-") == 0)
+      ret = runStdin(&d8);
+   else
+      ret = run(&d8, argc-2, argv+2);
+
+   daisy8Close(&d8);
+   return ret;
+}
@@ -0,0 +1,375 @@
+/************************************************************************
+  bench-arm - Instruction count benchmark of the libdht decoders
+
+  The production target is a 400 MHz ARM926EJ-S (ARMv5TE) without FPU
+  and without hardware divide, where the decoding cost differs a lot
+  from x86. This program runs one stage of the decoding path on every
+  sensor transaction of a capture corpus (written by tools/dht-capture
+  in binary format), or on synthetic transactions if no corpus is given:
+
+  - spi:      decode_data() of the SPI transport and checksum
+  - gpio:     dhtDecodeEdges() (bit decoder of the GPIO transport,
+              with checksum)
+  - convert:  dhtFrameToTenths()
+  - float:    getTemperature() and getHumidity()
+
+  It is cross built for armv5te soft-float and run under qemu-arm with
+  an instruction counting plugin by insn-count.sh, which subtracts a run
+  without iterations and reports the instructions per frame.
+
+  Author: Ondrej Wisniewski
+
+  Build command:
+  make bench-arm
+
+************************************************************************/
+
+// decode_data() is internal to the SPI transport
+#include "../dht_spi.c"
+#include "../tools/capture_format.h"
+
+#define MAX_EDGES 128
+
+/* Imported variables */
+extern int16_t temperature;
+extern int16_t humidity;
+
+/* Sensor transaction of the corpus */
+typedef struct {
+   uint8_t  type;          // CAPTURE_SPI or CAPTURE_EDGES
+   uint8_t  model;
+   uint32_t rate;          // SPI sample rate
+   uint32_t count;         // number of samples or edges
+   uint8_t  *samples;      // SPI line samples (MSB first)
+   DHT_EDGE_t *edges;
+   uint8_t  frame[DHT_FRAME_SIZE];   // decoded frame
+   int16_t  temperature;   // converted reading
+   int16_t  humidity;
+   int      ok;            // frame is valid
+}
+TRANSACTION_t;
+
+static TRANSACTION_t *corpus;
+static int corpus_size;
+
+static volatile int32_t sink;
+
+
+/*********************************************************************
+ * Function:    le32()
+ *
+ * Description: Gets a little endian 32 bit number
+ *
+ ********************************************************************/
+static uint32_t le32(const uint8_t *b)
+{
+   return b[0] | b[1]<<8 | b[2]<<16 | (uint32_t)b[3]<<24;
+}
+
+/*********************************************************************
+ * Function:    add_transaction()
+ *
+ * Description: Adds an empty transaction to the corpus
+ *
+ ********************************************************************/
+static TRANSACTION_t *add_transaction(void)
+{
+   TRANSACTION_t *t;
+
+   t = realloc(corpus, (corpus_size + 1) * sizeof(TRANSACTION_t));
+   if (t == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(-1);
+   }
+   corpus = t;
+   t = &corpus[corpus_size++];
+   memset(t, 0, sizeof(*t));
+   return t;
+}
+
+/*********************************************************************
+ * Function:    load_corpus()
+ *
+ * Description: Loads the transactions of a binary capture file
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int load_corpus(const char *filename)
+{
+   uint8_t hdr[CAPTURE_RECORD_HDR];
+   uint8_t b[4];
+   TRANSACTION_t *t;
+   uint32_t i, len;
+   int truncated = 0;
+   FILE *f;
+
+   f = fopen(filename, "rb");
+   if (f == NULL) {
+      fprintf(stderr, "Open %s: %s\n", filename, strerror(errno));
+      return -1;
+   }
+   if (fread(hdr, 1, CAPTURE_FILE_HDR, f) != CAPTURE_FILE_HDR ||
+       memcmp(hdr, CAPTURE_MAGIC, 6) != 0 || hdr[6] != CAPTURE_VERSION) {
+      fprintf(stderr, "%s is not a capture file\n", filename);
+      fclose(f);
+      return -1;
+   }
+
+   while (fread(hdr, 1, CAPTURE_RECORD_HDR, f) == CAPTURE_RECORD_HDR) {
+      t = add_transaction();
+      t->type  = hdr[0];
+      t->model = hdr[1];
+      t->rate  = le32(&hdr[8]);
+      t->count = le32(&hdr[12]);
+      if (t->type == CAPTURE_SPI) {
+         len = (t->count + 7) / 8;
+         t->samples = malloc(len);
+         if (t->samples == NULL || fread(t->samples, 1, len, f) != len) {
+            truncated = 1;
+            break;
+         }
+      }
+      else {
+         t->edges = malloc(t->count * sizeof(DHT_EDGE_t));
+         for (i=0; t->edges && i<t->count && fread(b, 1, 4, f) == 4; i++) {
+            t->edges[i].time = le32(b) & CAPTURE_TIME_MASK;
+            t->edges[i].level = (le32(b) & CAPTURE_LEVEL) ? 1 : 0;
+            t->edges[i].samples = 0;
+         }
+         if (i < t->count) {
+            truncated = 1;
+            break;
+         }
+         // dht-capture records the start signal (LOW) and the release
+         // of the line (HIGH) before the sensor response. The decoder
+         // expects the release as first edge and time reference.
+         for (i=0; i<t->count && t->edges[i].level == 0; i++);
+         if (i < t->count) {
+            t->count -= i;
+            memmove(t->edges, &t->edges[i], t->count * sizeof(DHT_EDGE_t));
+            for (i=t->count; i-- > 0; )
+               t->edges[i].time -= t->edges[0].time;
+         }
+         if (t->count > MAX_EDGES)
+            t->count = MAX_EDGES;
+      }
+   }
+   if (truncated) {
+      fprintf(stderr, "%s: truncated record\n", filename);
+      corpus_size--;
+   }
+   fclose(f);
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    segment()
+ *
+ * Description: Adds a period of constant line level to a synthetic
+ *              transaction as captured by both transports
+ *
+ * Parameters:  spi (in/out)  : SPI transaction
+ *              gpio (in/out) : GPIO transaction
+ *              t (in/out)    : start time of the period (us)
+ *              level (in)    : line level
+ *              duration (in) : length of the period (us)
+ *
+ ********************************************************************/
+static void segment(TRANSACTION_t *spi, TRANSACTION_t *gpio, uint32_t *t,
+                    int level, uint32_t duration)
+{
+   uint32_t bit = (uint64_t)*t * spi->rate / 1000000;
+   uint32_t end = (uint64_t)(*t + duration) * spi->rate / 1000000;
+
+   gpio->edges[gpio->count].time = *t;
+   gpio->edges[gpio->count++].level = level;
+   for (; level && bit < end && bit < spi->count; bit++)
+      spi->samples[bit/8] |= 0x80 >> (bit%8);
+   *t += duration;
+}
+
+/*********************************************************************
+ * Function:    synthesize()
+ *
+ * Description: Creates a transaction as captured by both transports
+ *              for a sensor sending the given frame
+ *
+ * Parameters:  model (in) : sensor model
+ *              frame (in) : sensor data frame to send
+ *
+ ********************************************************************/
+static void synthesize(DHT_MODEL_t model, const uint8_t *frame)
+{
+   TRANSACTION_t *spi = add_transaction();
+   TRANSACTION_t *gpio = add_transaction();
+   uint32_t start = (model == DHT11 ? 12000 : 800);   // as readSensor_spi()
+   uint32_t t = start;
+   int i;
+
+   spi->type = CAPTURE_SPI;
+   spi->model = model;
+   spi->rate = 550000;
+   spi->count = (uint64_t)(start + 6000) * spi->rate / 1000000 / 8 * 8;
+   spi->samples = calloc(spi->count / 8, 1);
+   gpio->type = CAPTURE_EDGES;
+   gpio->model = model;
+   gpio->rate = 1000000;
+   gpio->edges = calloc(MAX_EDGES, sizeof(DHT_EDGE_t));
+
+   // Host released the line after the start signal (LOW), the sensor
+   // answers LOW and HIGH, then sends 40 bits: LOW 50us, then HIGH
+   // 27us (zero) or 70us (one)
+   segment(spi, gpio, &t, 1, 20);
+   segment(spi, gpio, &t, 0, 80);
+   segment(spi, gpio, &t, 1, 80);
+   for (i=0; i<DHT_FRAME_SIZE*8; i++) {
+      segment(spi, gpio, &t, 0, 50);
+      segment(spi, gpio, &t, 1, (frame[i/8] & 0x80>>(i%8)) ? 70 : 27);
+   }
+   segment(spi, gpio, &t, 0, 50);
+   segment(spi, gpio, &t, 1, start + 6000 - t);
+}
+
+/*********************************************************************
+ * Function:    decode_spi()
+ *
+ * Description: SPI path as readSensor_spi()
+ *
+ ********************************************************************/
+static int decode_spi(TRANSACTION_t *t)
+{
+   uint8_t checksum = 0;
+   int i;
+
+   speed = t->rate;
+   if (decode_data(t->samples, t->frame, t->count))
+      return 0;
+   for (i=0; i<RSP_DATA_SIZE-1; i++)
+      checksum += t->frame[i];
+   return (checksum == t->frame[4]);
+}
+
+/*********************************************************************
+ * Function:    decode_gpio()
+ *
+ * Description: GPIO path as readSensor_gpio() after edge extraction
+ *
+ ********************************************************************/
+static int decode_gpio(TRANSACTION_t *t)
+{
+   return (dhtDecodeEdges(t->edges, t->count, t->frame, NULL) == ERROR_NONE);
+}
+
+/*********************************************************************
+ * Function:    run()
+ *
+ * Description: Runs a stage on all transactions of the corpus
+ *
+ ********************************************************************/
+static void run(const char *stage)
+{
+   TRANSACTION_t *t;
+   int i;
+
+   for (i=0; i<corpus_size; i++) {
+      t = &corpus[i];
+      if (strcmp(stage, "spi") == 0) {
+         if (t->type == CAPTURE_SPI)
+            sink += decode_spi(t);
+      }
+      else if (strcmp(stage, "gpio") == 0) {
+         if (t->type == CAPTURE_EDGES)
+            sink += decode_gpio(t);
+      }
+      else if (!t->ok)
+         continue;
+      else if (strcmp(stage, "convert") == 0) {
+         dhtFrameToTenths(t->frame, t->model, &t->temperature, &t->humidity);
+         sink += t->temperature + t->humidity;
+      }
+      else if (strcmp(stage, "float") == 0) {
+         temperature = t->temperature;
+         humidity = t->humidity;
+         sink += (int32_t)(getTemperature() + getHumidity());
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("bench-arm - run a stage of the libdht decoding path on a capture corpus\n\n");
+   printf("Usage: bench-arm [options] [<capture file>]\n");
+   printf("Options:\n");
+   printf("       -n <count>   iterations over the corpus (default: 1)\n");
+   printf("       -s <stage>   spi|gpio|convert|float (default: spi)\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   static const uint8_t dht22_frame[] = { 0x02, 0x8c, 0x80, 0x22, 0x30 };
+   static const uint8_t dht11_frame[] = { 0x2d, 0x00, 0x17, 0x00, 0x44 };
+   const char *stage = "spi";
+   long n = 1, k;
+   int i, opt, frames = 0, ok = 0;
+
+
+   while ((opt = getopt(argc, argv, "n:s:h")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n': n = strtol(optarg, NULL, 0); break;
+         case 's': stage = optarg; break;
+         default:
+            usage();
+            return -1;
+      }
+   }
+   if (strcmp(stage, "spi") && strcmp(stage, "gpio") &&
+       strcmp(stage, "convert") && strcmp(stage, "float")) {
+      usage();
+      return -1;
+   }
+
+   if (optind < argc) {
+      if (load_corpus(argv[optind]) < 0)
+         return -1;
+   }
+   else {
+      synthesize(DHT22, dht22_frame);
+      synthesize(DHT11, dht11_frame);
+   }
+
+   // Decode once, so the conversion stages have their input and the
+   // frames to count are known also without iterations
+   for (i=0; i<corpus_size; i++) {
+      if (corpus[i].type == CAPTURE_SPI)
+         corpus[i].ok = decode_spi(&corpus[i]);
+      else
+         corpus[i].ok = decode_gpio(&corpus[i]);
+      if (corpus[i].ok)
+         dhtFrameToTenths(corpus[i].frame, corpus[i].model,
+                          &corpus[i].temperature, &corpus[i].humidity);
+
+      if ((strcmp(stage, "spi") == 0 && corpus[i].type == CAPTURE_SPI) ||
+          (strcmp(stage, "gpio") == 0 && corpus[i].type == CAPTURE_EDGES) ||
+          (strcmp(stage, "convert") == 0 && corpus[i].ok) ||
+          (strcmp(stage, "float") == 0 && corpus[i].ok)) {
+         frames++;
+         ok += corpus[i].ok;
+      }
+   }
+
+   for (k=0; k<n; k++)
+      run(stage);
+
+   printf("stage: %s frames: %d valid: %d\n", stage, frames, ok);
+   return 0;
+}
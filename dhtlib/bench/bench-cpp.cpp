@@ -0,0 +1,228 @@
+/************************************************************************
+  bench-cpp - Compare the C and the C++ interface of libdht
+
+  The sensor transaction itself is bound by the sensor timing, what the
+  interfaces can differ in is the work done on the captured response.
+  This benchmark feeds a synthetic DHT response, sampled like the GPIO
+  transport does, to both of them and measures the time from the line
+  samples to the converted reading:
+
+  - C path:   dhtSamplesToEdges(), dhtDecodeEdges(), dhtFrameToTenths()
+              with the sensor model known at runtime only
+  - C++ path: dht::decode<Model>() and Model::convert()
+
+  Both must return the same reading, otherwise the benchmark fails.
+
+  Author: Ondrej Wisniewski
+
+  Build command:
+  make
+
+************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <unistd.h>
+#include <time.h>
+
+#include "dht.hpp"
+
+#define CAPTURE_WINDOW 5500
+#define MAX_SAMPLES 8192
+#define MAX_EDGES 128
+
+static uint32_t sample_time[MAX_SAMPLES];
+static uint8_t  sample_level[MAX_SAMPLES];
+
+// The C library gets the model from a variable set at setup time
+static volatile DHT_MODEL_t sensor_model;
+
+
+/*********************************************************************
+ * Function:    nanos()
+ *
+ * Description: Reads the current monotonic time in ns
+ *
+ ********************************************************************/
+static uint64_t nanos(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+/*********************************************************************
+ * Function:    synthesize()
+ *
+ * Description: Creates the line samples of a sensor response, taken
+ *              every period us after the host released the line
+ *
+ * Parameters:  frame (in)  : sensor data frame to send
+ *              period (in) : sample period in us
+ *
+ * Return:      number of samples
+ *
+ ********************************************************************/
+static int synthesize(const uint8_t *frame, uint32_t period)
+{
+   uint32_t level_end[2 + 3 + 80 + 1];
+   uint8_t  level[2 + 3 + 80 + 1];
+   uint32_t t = 0;
+   int i, n = 0, k = 0;
+
+   // released (HIGH), response LOW and HIGH
+   level[n] = 1; t += 20; level_end[n++] = t;
+   level[n] = 0; t += 80; level_end[n++] = t;
+   level[n] = 1; t += 80; level_end[n++] = t;
+   // data bits: LOW, then HIGH for 27 (zero) or 70us (one)
+   for (i=0; i<DHT_FRAME_SIZE*8; i++) {
+      level[n] = 0; t += 50; level_end[n++] = t;
+      level[n] = 1; t += (frame[i/8] & 0x80>>(i%8)) ? 70 : 27; level_end[n++] = t;
+   }
+   // end of transmission, then idle
+   level[n] = 0; t += 50; level_end[n++] = t;
+   level[n] = 1; level_end[n++] = CAPTURE_WINDOW + 1;
+
+   for (i=0, t=0; t<=CAPTURE_WINDOW && i<MAX_SAMPLES; i++, t+=period) {
+      while (t >= level_end[k])
+         k++;
+      sample_time[i] = 1000000 + t;
+      sample_level[i] = level[k];
+   }
+   return i;
+}
+
+/*********************************************************************
+ * Function:    read_c()
+ *
+ * Description: C path from line samples to reading
+ *
+ ********************************************************************/
+static dht::Reading read_c(int num_samples)
+{
+   static DHT_EDGE_t edges[MAX_EDGES];
+   dht::Reading r = dht::Reading();
+   int num_edges;
+
+   num_edges = dhtSamplesToEdges(sample_time, sample_level, num_samples, edges, MAX_EDGES);
+   r.error = dhtDecodeEdges(edges, num_edges, r.frame, NULL);
+   if (r.error == ERROR_NONE)
+      dhtFrameToTenths(r.frame, sensor_model, &r.temperature, &r.humidity);
+   return r;
+}
+
+/*********************************************************************
+ * Function:    read_cpp()
+ *
+ * Description: C++ path from line samples to reading
+ *
+ ********************************************************************/
+template<class Model>
+static dht::Reading read_cpp(int num_samples)
+{
+   dht::Reading r = dht::Reading();
+
+   r.error = dht::decode<Model>(sample_time, sample_level, num_samples, r.frame);
+   if (r.error == ERROR_NONE)
+      Model::convert(r.frame, r.temperature, r.humidity);
+   return r;
+}
+
+/*********************************************************************
+ * Function:    run()
+ *
+ * Description: Benchmarks both paths for one model and sample period
+ *
+ * Return:      0 if both paths read the same values, -1 otherwise
+ *
+ ********************************************************************/
+template<class Model>
+static int run(const char *name, const uint8_t *frame, uint32_t period, long iterations)
+{
+   dht::Reading rc, rcpp;
+   uint64_t t0, tc, tcpp;
+   long i;
+   int n;
+
+   n = synthesize(frame, period);
+   sensor_model = Model::model;
+
+   t0 = nanos();
+   for (i=0; i<iterations; i++)
+      rc = read_c(n);
+   tc = nanos() - t0;
+
+   t0 = nanos();
+   for (i=0; i<iterations; i++) {
+      rcpp = read_cpp<Model>(n);
+      // keep the compiler from hoisting the call out of the loop
+      asm volatile("" : : "r"(&rcpp) : "memory");
+   }
+   tcpp = nanos() - t0;
+
+   printf("%-6s %6u %8d %10.1f %10.1f %7.2f\n", name, period, n,
+          (double)tc/iterations, (double)tcpp/iterations, (double)tc/tcpp);
+
+   if (rc.error != ERROR_NONE || rcpp.error != ERROR_NONE ||
+       rc.temperature != rcpp.temperature || rc.humidity != rcpp.humidity) {
+      fprintf(stderr, "%s: readings differ (C: %d %d/%d, C++: %d %d/%d)\n", name,
+              rc.error, rc.temperature, rc.humidity,
+              rcpp.error, rcpp.temperature, rcpp.humidity);
+      return -1;
+   }
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("bench-cpp - compare decoding time of the C and C++ libdht interface\n\n");
+   printf("Usage: bench-cpp [options]\n");
+   printf("Options:\n");
+   printf("       -n <count>   iterations per measurement (default: 20000)\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   // 65.2 %, 35.1 °C resp. 65 %, 35 °C
+   static const uint8_t dht22_frame[DHT_FRAME_SIZE] = { 0x02, 0x8c, 0x01, 0x5f, 0xee };
+   static const uint8_t dht11_frame[DHT_FRAME_SIZE] = { 0x41, 0x00, 0x23, 0x00, 0x64 };
+   static const uint32_t periods[] = { 1, 2, 4 };
+   long iterations = 20000;
+   unsigned i;
+   int opt, ret = 0;
+
+   while ((opt = getopt(argc, argv, "n:h")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n':
+            iterations = strtol(optarg, NULL, 0);
+            break;
+         default:
+            usage();
+            return -1;
+      }
+   }
+   if (iterations <= 0)
+   {
+      usage();
+      return -1;
+   }
+
+   printf("model  period  samples     C (ns)   C++ (ns) speedup\n");
+   for (i=0; i<sizeof(periods)/sizeof(periods[0]); i++)
+   {
+      ret |= run<dht::Dht11>("DHT11", dht11_frame, periods[i], iterations);
+      ret |= run<dht::Dht22>("DHT22", dht22_frame, periods[i], iterations);
+   }
+
+   return ret;
+}
@@ -0,0 +1,564 @@
+/************************************************************************
+  bench-gpio - Compare the ways of sampling a GPIO line from user space
+
+  The GPIO transport of libdht decodes the sensor response from line
+  samples taken in a tight loop, so the sample rate and its jitter
+  decide how reliable it is. This benchmark samples one input line
+  with each access method available on the system:
+
+  - sysfs-pread:  pread() of the sysfs value file (as digitalRead())
+  - sysfs-read:   lseek() and read() of the sysfs value file
+  - chardev:      GPIO_V2_LINE_GET_VALUES_IOCTL on a line request
+  - edge:         edge events of a line request (the line is toggled
+                  by the benchmark, see --toggle)
+  - mmap:         reading the data register of the GPIO controller
+                  mapped from /dev/mem
+
+  and reports the sample rate, the distribution of the time between
+  two samples (per event for the edge method: time from toggling the
+  line to reading the event) and the CPU time per sample and in % of
+  the run time.
+
+  Without target hardware the benchmark runs against gpio-sim lines,
+  see gpio-sim.sh.
+
+  Author: Ondrej Wisniewski
+
+  Build command:
+  make bench-gpio
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <linux/gpio.h>
+
+#define GPIO_BASE_DIR  "/sys/class/gpio"
+#define EXPORT_FILE    "/sys/class/gpio/export"
+#define UNEXPORT_FILE  "/sys/class/gpio/unexport"
+#define CONSUMER       "bench-gpio"
+
+#define DEFAULT_SAMPLES 100000
+#define DEFAULT_EVENTS  2000
+#define EVENT_TIMEOUT   1000    // ms
+
+/* Benchmark configuration */
+static struct {
+   const char *chip;       // GPIO chip device
+   int line;               // line offset on the chip
+   int pin;                // kernel GPIO number for sysfs
+   const char *value;      // sysfs value file
+   const char *toggle;     // file to toggle the line for edge events
+   const char *mem;        // memory device for mmap
+   off_t regs;             // address of the data register
+   int bit;                // bit of the line in the data register
+   long samples;
+   long events;
+} cfg = {
+   .line    = -1,
+   .pin     = -1,
+   .mem     = "/dev/mem",
+   .regs    = -1,
+   .samples = DEFAULT_SAMPLES,
+   .events  = DEFAULT_EVENTS
+};
+
+/* Results of one method */
+typedef struct {
+   long n;                 // samples taken
+   uint64_t wall;          // run time (ns)
+   uint64_t cpu;           // user + system time (ns)
+   uint32_t *delta;        // time between samples (ns)
+}
+RESULT_t;
+
+static int sysfs_fd = -1;
+static int line_fd = -1;
+static volatile uint32_t *reg;
+static void *map;
+static size_t map_size;
+
+
+/*********************************************************************
+ * Function:    nanos()
+ *
+ * Description: Reads the current monotonic time in ns
+ *
+ ********************************************************************/
+static uint64_t nanos(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+/*********************************************************************
+ * Function:    cpu_nanos()
+ *
+ * Description: Reads the CPU time (user + system) used so far in ns
+ *
+ ********************************************************************/
+static uint64_t cpu_nanos(void)
+{
+   struct rusage ru;
+   getrusage(RUSAGE_SELF, &ru);
+   return ((uint64_t)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)*1000000000 +
+          ((uint64_t)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)*1000;
+}
+
+/*********************************************************************
+ * Function:    write_file()
+ *
+ * Description: Writes a string to a (sysfs) file
+ *
+ * Return:      0 on success, -1 on error (errno is set)
+ *
+ ********************************************************************/
+static int write_file(const char *filename, const char *s)
+{
+   int fd, n;
+
+   fd = open(filename, O_WRONLY);
+   if (fd < 0)
+      return -1;
+   n = write(fd, s, strlen(s));
+   close(fd);
+   return (n == (int)strlen(s) ? 0 : -1);
+}
+
+
+/*********************************************************************
+ * Sample functions of the access methods, return the line level
+ ********************************************************************/
+
+static int sample_sysfs_pread(void)
+{
+   char d;
+   if (pread(sysfs_fd, &d, 1, 0) != 1)
+      return -1;
+   return d - '0';
+}
+
+static int sample_sysfs_read(void)
+{
+   char d;
+   if (lseek(sysfs_fd, 0, SEEK_SET) < 0 || read(sysfs_fd, &d, 1) != 1)
+      return -1;
+   return d - '0';
+}
+
+static int sample_chardev(void)
+{
+   struct gpio_v2_line_values values = { .bits = 0, .mask = 1 };
+   if (ioctl(line_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0)
+      return -1;
+   return values.bits & 1;
+}
+
+static int sample_mmap(void)
+{
+   return (*reg >> cfg.bit) & 1;
+}
+
+
+/*********************************************************************
+ * Setup and cleanup of the access methods, setup returns 0 if the
+ * method is available
+ ********************************************************************/
+
+static int exported;
+
+static int setup_sysfs(void)
+{
+   char b[256];
+
+   if (cfg.value == NULL) {
+      if (cfg.pin < 0)
+         return -1;
+      snprintf(b, sizeof(b), "%d", cfg.pin);
+      if (write_file(EXPORT_FILE, b) == 0)
+         exported = 1;
+      else if (errno != EBUSY) {
+         fprintf(stderr, "Unable to export GPIO %d: %s\n", cfg.pin, strerror(errno));
+         return -1;
+      }
+      snprintf(b, sizeof(b), GPIO_BASE_DIR "/gpio%d/direction", cfg.pin);
+      write_file(b, "in");
+      snprintf(b, sizeof(b), GPIO_BASE_DIR "/gpio%d/value", cfg.pin);
+   }
+   else
+      snprintf(b, sizeof(b), "%s", cfg.value);
+
+   sysfs_fd = open(b, O_RDONLY);
+   if (sysfs_fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+      return -1;
+   }
+   return 0;
+}
+
+static void cleanup_sysfs(void)
+{
+   char b[16];
+
+   if (sysfs_fd >= 0) close(sysfs_fd);
+   sysfs_fd = -1;
+   if (exported) {
+      snprintf(b, sizeof(b), "%d", cfg.pin);
+      write_file(UNEXPORT_FILE, b);
+      exported = 0;
+   }
+}
+
+static int request_line(uint64_t flags)
+{
+   struct gpio_v2_line_request req;
+   int fd;
+
+   if (cfg.chip == NULL || cfg.line < 0)
+      return -1;
+
+   fd = open(cfg.chip, O_RDONLY);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", cfg.chip, strerror(errno));
+      return -1;
+   }
+   memset(&req, 0, sizeof(req));
+   req.offsets[0] = cfg.line;
+   req.num_lines = 1;
+   req.config.flags = flags;
+   strcpy(req.consumer, CONSUMER);
+   if (ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+      fprintf(stderr, "Unable to request line %d of %s: %s\n",
+              cfg.line, cfg.chip, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   close(fd);
+   line_fd = req.fd;
+   return 0;
+}
+
+static int setup_chardev(void)
+{
+   return request_line(GPIO_V2_LINE_FLAG_INPUT);
+}
+
+static int setup_edge(void)
+{
+   if (cfg.toggle == NULL)
+      return -1;
+   return request_line(GPIO_V2_LINE_FLAG_INPUT |
+                       GPIO_V2_LINE_FLAG_EDGE_RISING |
+                       GPIO_V2_LINE_FLAG_EDGE_FALLING);
+}
+
+static void cleanup_line(void)
+{
+   if (line_fd >= 0) close(line_fd);
+   line_fd = -1;
+}
+
+static int setup_mmap(void)
+{
+   long page = sysconf(_SC_PAGESIZE);
+   off_t base;
+   int fd;
+
+   if (cfg.regs < 0)
+      return -1;
+
+   fd = open(cfg.mem, O_RDONLY | O_SYNC);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", cfg.mem, strerror(errno));
+      return -1;
+   }
+   base = cfg.regs & ~(off_t)(page - 1);
+   map_size = page;
+   map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, base);
+   close(fd);
+   if (map == MAP_FAILED) {
+      fprintf(stderr, "Unable to map %s at 0x%lx: %s\n", cfg.mem,
+              (unsigned long)base, strerror(errno));
+      map = NULL;
+      return -1;
+   }
+   reg = (volatile uint32_t*)((char*)map + (cfg.regs - base));
+   return 0;
+}
+
+static void cleanup_mmap(void)
+{
+   if (map) munmap(map, map_size);
+   map = NULL;
+}
+
+
+/*********************************************************************
+ * Function:    set_level()
+ *
+ * Description: Drives the line to a level through the toggle file,
+ *              which is a gpio-sim pull attribute or a value file
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+static int set_level(int fd, int level)
+{
+   const char *pull = (level ? "pull-up" : "pull-down");
+
+   if (pwrite(fd, pull, strlen(pull), 0) >= 0)
+      return 0;
+   return (pwrite(fd, level ? "1" : "0", 1, 0) == 1 ? 0 : -1);
+}
+
+/*********************************************************************
+ * Function:    run_samples()
+ *
+ * Description: Samples the line in a tight loop like the GPIO
+ *              transport does, storing the time of each sample
+ *
+ * Parameters:  sample (in) : sample function of the method
+ *              res (out)   : results
+ *
+ * Return:      0 on success, -1 if sampling failed
+ *
+ ********************************************************************/
+static int run_samples(int (*sample)(void), RESULT_t *res)
+{
+   uint64_t start, cpu, prev, now;
+   long i;
+
+   start = nanos();
+   cpu = cpu_nanos();
+   prev = start;
+   for (i=0; i<cfg.samples; i++) {
+      if (sample() < 0) {
+         fprintf(stderr, "Sampling failed: %s\n", strerror(errno));
+         return -1;
+      }
+      now = nanos();
+      res->delta[i] = now - prev;
+      prev = now;
+   }
+   res->n = cfg.samples;
+   res->wall = nanos() - start;
+   res->cpu = cpu_nanos() - cpu;
+   return 0;
+}
+
+/*********************************************************************
+ * Function:    run_events()
+ *
+ * Description: Toggles the line and waits for each edge event
+ *
+ * Parameters:  res (out) : results
+ *
+ * Return:      0 on success, -1 if an event is missing
+ *
+ ********************************************************************/
+static int run_events(RESULT_t *res)
+{
+   struct gpio_v2_line_event event;
+   struct pollfd pfd = { .fd = line_fd, .events = POLLIN };
+   uint64_t start, cpu, toggled;
+   int fd;
+   long i;
+
+   fd = open(cfg.toggle, O_WRONLY);
+   if (fd < 0) {
+      fprintf(stderr, "Open %s: %s\n", cfg.toggle, strerror(errno));
+      return -1;
+   }
+   // start from a known level, and drop the event if it was a change
+   if (set_level(fd, 0) < 0) {
+      fprintf(stderr, "Unable to write %s: %s\n", cfg.toggle, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   while (poll(&pfd, 1, 10) > 0 && read(line_fd, &event, sizeof(event)) > 0);
+
+   start = nanos();
+   cpu = cpu_nanos();
+   for (i=0; i<cfg.events; i++) {
+      toggled = nanos();
+      if (set_level(fd, !(i & 1)) < 0) {
+         fprintf(stderr, "Unable to write %s: %s\n", cfg.toggle, strerror(errno));
+         break;
+      }
+      if (poll(&pfd, 1, EVENT_TIMEOUT) <= 0 ||
+          read(line_fd, &event, sizeof(event)) != sizeof(event)) {
+         fprintf(stderr, "No edge event after toggling the line\n");
+         break;
+      }
+      res->delta[i] = nanos() - toggled;
+   }
+   res->n = i;
+   res->wall = nanos() - start;
+   res->cpu = cpu_nanos() - cpu;
+   close(fd);
+   return (i == cfg.events ? 0 : -1);
+}
+
+/*********************************************************************
+ * Function:    compare()
+ *
+ * Description: qsort() comparison of sample times
+ *
+ ********************************************************************/
+static int compare(const void *a, const void *b)
+{
+   uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+   return (x > y) - (x < y);
+}
+
+/*********************************************************************
+ * Function:    report()
+ *
+ * Description: Prints the results of a method
+ *
+ ********************************************************************/
+static void report(const char *name, RESULT_t *res)
+{
+   if (res->n == 0 || res->wall == 0) {
+      printf("%-12s %s\n", name, "failed");
+      return;
+   }
+   qsort(res->delta, res->n, sizeof(uint32_t), compare);
+   printf("%-12s %8ld %12.0f %9u %9u %9u %10.0f %5.1f\n", name, res->n,
+          res->n * 1e9 / res->wall,
+          res->delta[res->n/2], res->delta[res->n*99/100], res->delta[res->n-1],
+          (double)res->cpu / res->n, res->cpu * 100.0 / res->wall);
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("bench-gpio - compare the GPIO access methods for sampling a line\n\n");
+   printf("Usage: bench-gpio [options]\n");
+   printf("Options:\n");
+   printf("       --chip=<dev>        GPIO chip for the chardev and edge methods (/dev/gpiochipN)\n");
+   printf("       --line=<n>          line offset on the chip\n");
+   printf("       --pin=<n>           kernel GPIO number for the sysfs methods (exported if needed)\n");
+   printf("       --value=<file>      sysfs value file to use instead of --pin\n");
+   printf("       --toggle=<file>     file toggling the line for the edge method\n");
+   printf("                           (gpio-sim pull attribute, or a 0/1 value file of an output\n");
+   printf("                           looped back to the line)\n");
+   printf("       --regs=<addr>:<bit> physical address of the data register and bit of the line\n");
+   printf("                           for the mmap method (e.g. AT91 PIOA_PDSR: 0xfffff43c)\n");
+   printf("       --mem=<file>        memory device for the mmap method (default: /dev/mem)\n");
+   printf("       --samples=<n>       samples per method (default: %d)\n", DEFAULT_SAMPLES);
+   printf("       --events=<n>        edge events (default: %d)\n", DEFAULT_EVENTS);
+   printf("Methods missing their options are skipped.\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   static const struct option options[] = {
+      { "chip",    required_argument, NULL, 'c' },
+      { "line",    required_argument, NULL, 'l' },
+      { "pin",     required_argument, NULL, 'p' },
+      { "value",   required_argument, NULL, 'v' },
+      { "toggle",  required_argument, NULL, 't' },
+      { "regs",    required_argument, NULL, 'r' },
+      { "mem",     required_argument, NULL, 'm' },
+      { "samples", required_argument, NULL, 'n' },
+      { "events",  required_argument, NULL, 'e' },
+      { "help",    no_argument,       NULL, 'h' },
+      { NULL, 0, NULL, 0 }
+   };
+   static const struct {
+      const char *name;
+      int (*setup)(void);
+      void (*cleanup)(void);
+      int (*sample)(void);     // NULL for the edge method
+   } methods[] = {
+      { "sysfs-pread", setup_sysfs,   cleanup_sysfs, sample_sysfs_pread },
+      { "sysfs-read",  setup_sysfs,   cleanup_sysfs, sample_sysfs_read },
+      { "chardev",     setup_chardev, cleanup_line,  sample_chardev },
+      { "edge",        setup_edge,    cleanup_line,  NULL },
+      { "mmap",        setup_mmap,    cleanup_mmap,  sample_mmap }
+   };
+   RESULT_t res;
+   char *end;
+   int i, opt, ran = 0, failed = 0;
+
+
+   while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+   {
+      switch (opt)
+      {
+         case 'c': cfg.chip = optarg; break;
+         case 'l': cfg.line = atoi(optarg); break;
+         case 'p': cfg.pin = atoi(optarg); break;
+         case 'v': cfg.value = optarg; break;
+         case 't': cfg.toggle = optarg; break;
+         case 'm': cfg.mem = optarg; break;
+         case 'r':
+            cfg.regs = strtoull(optarg, &end, 0);
+            cfg.bit = (*end == ':' ? atoi(end+1) : 0);
+            if (cfg.bit < 0 || cfg.bit > 31) {
+               fprintf(stderr, "Invalid register bit %d\n", cfg.bit);
+               return -1;
+            }
+            break;
+         case 'n': cfg.samples = strtol(optarg, NULL, 0); break;
+         case 'e': cfg.events = strtol(optarg, NULL, 0); break;
+         default:
+            usage();
+            return -1;
+      }
+   }
+   if (cfg.samples <= 0 || cfg.events <= 0) {
+      usage();
+      return -1;
+   }
+
+   res.delta = malloc(sizeof(uint32_t) *
+                      (cfg.samples > cfg.events ? cfg.samples : cfg.events));
+   if (res.delta == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      return -1;
+   }
+
+   for (i=0; i<sizeof(methods)/sizeof(methods[0]); i++)
+   {
+      memset(&res, 0, offsetof(RESULT_t, delta));
+      if (methods[i].setup() < 0) {
+         methods[i].cleanup();
+         continue;
+      }
+      if (ran++ == 0)
+         printf("method        samples    samples/s  p50 (ns)  p99 (ns)  max (ns) cpu ns/smp  cpu%%\n");
+      if ((methods[i].sample ? run_samples(methods[i].sample, &res) : run_events(&res)) < 0)
+         failed++;
+      report(methods[i].name, &res);
+      methods[i].cleanup();
+   }
+
+   free(res.delta);
+   if (ran == 0) {
+      fprintf(stderr, "No access method configured\n\n");
+      usage();
+      return -1;
+   }
+   return (failed ? -1 : 0);
+}
@@ -0,0 +1,48 @@
+#! /bin/bash
+##################################################################################
+#
+# Author:        Ondrej Wisniewski
+#
+# Description:   Creates (or removes) a simulated GPIO chip with the gpio-sim
+#                kernel module, to run bench-gpio on any Linux box. Prints the
+#                bench-gpio options for its line 0.
+#                Requires root, configfs and CONFIG_GPIO_SIM.
+#
+# Usage:         gpio-sim.sh [remove]
+#
+# Last modified: 18/10/2026
+#
+##################################################################################
+
+CONFIGFS="/sys/kernel/config"
+SIM_DIR="$CONFIGFS/gpio-sim/bench-gpio"
+NUM_LINES=8
+
+if [ "$1" == "remove" ]; then
+   [ -d $SIM_DIR ] || exit 0
+   echo 0 > $SIM_DIR/live
+   rmdir $SIM_DIR/gpio-bank0 $SIM_DIR
+   exit 0
+fi
+
+modprobe gpio-sim || exit 1
+mountpoint -q $CONFIGFS || mount -t configfs none $CONFIGFS || exit 1
+
+if [ ! -d $SIM_DIR ]; then
+   mkdir -p $SIM_DIR/gpio-bank0 || exit 1
+   echo $NUM_LINES > $SIM_DIR/gpio-bank0/num_lines
+   echo 1 > $SIM_DIR/live || exit 1
+fi
+
+DEV_NAME=$(cat $SIM_DIR/dev_name)
+CHIP_NAME=$(cat $SIM_DIR/gpio-bank0/chip_name)
+OPTIONS="--chip=/dev/$CHIP_NAME --line=0 --toggle=/sys/devices/platform/$DEV_NAME/$CHIP_NAME/sim_gpio0/pull"
+
+# Kernel GPIO number for the sysfs methods (if the sysfs interface is enabled)
+for c in /sys/class/gpio/gpiochip*; do
+   if [ "$(basename $(readlink -f $c/device))" == "$CHIP_NAME" ]; then
+      OPTIONS="$OPTIONS --pin=$(cat $c/base)"
+   fi
+done
+
+echo "bench-gpio $OPTIONS"
@@ -0,0 +1,85 @@
+#! /bin/bash
+##################################################################################
+#
+# Author:        Ondrej Wisniewski
+#
+# Description:   Runs bench-arm (built for armv5te soft-float) under qemu-arm
+#                and reports the number of ARM instructions per frame of each
+#                stage of the decoding path, and the calls of the decoders to
+#                soft-float or memory allocation functions.
+#
+#                The instructions are counted with the libinsn.so TCG plugin
+#                of qemu (built from tests/plugin in the qemu sources). Without
+#                plugin every executed instruction is logged, which is much
+#                slower.
+#
+# Usage:         insn-count.sh [<capture file>]
+#
+# Environment:   QEMU         qemu user mode emulator (default: qemu-arm)
+#                QEMU_PLUGIN  path of libinsn.so (default: search)
+#                ITERATIONS   iterations over the corpus (default: 100, 10
+#                             without plugin)
+#                CROSS        cross toolchain prefix (default: arm-linux-gnueabi-)
+#
+# Last modified: 18/10/2026
+#
+##################################################################################
+
+QEMU=${QEMU:-qemu-arm}
+CROSS=${CROSS-arm-linux-gnueabi-}
+BENCH=./bench-arm
+CORPUS=$1
+LOG=$(mktemp)
+trap "rm -f $LOG" EXIT
+
+STAGES="spi gpio convert float"
+DECODERS="decode_data get_pulse_length get_bit dhtDecodeEdges dhtFrameToTenths"
+
+if [ -z "$QEMU_PLUGIN" ]; then
+   for p in /usr/lib/qemu/plugins /usr/local/lib/qemu/plugins /usr/libexec/qemu/plugins; do
+      [ -f $p/libinsn.so ] && QEMU_PLUGIN=$p/libinsn.so && break
+   done
+fi
+if [ -z "$QEMU_PLUGIN" ]; then
+   echo "libinsn.so not found, logging every instruction (slow)" >&2
+   ITERATIONS=${ITERATIONS:-10}
+fi
+ITERATIONS=${ITERATIONS:-100}
+
+# Run one stage: count <stage> <iterations>
+# prints the number of frames and of executed instructions
+count()
+{
+   local out insns
+
+   if [ -n "$QEMU_PLUGIN" ]; then
+      out=$($QEMU -plugin $QEMU_PLUGIN -d plugin -D $LOG $BENCH -s $1 -n $2 $CORPUS) || exit 1
+      insns=$(grep -o 'insns: *[0-9]*' $LOG | grep -o '[0-9]*$')
+   else
+      out=$($QEMU -one-insn-per-tb -d exec,nochain -D $LOG $BENCH -s $1 -n $2 $CORPUS) || exit 1
+      insns=$(grep -c '^Trace' $LOG)
+   fi
+   echo "$(echo $out | sed 's/.*frames: \([0-9]*\).*/\1/') $insns"
+}
+
+printf "%-8s %8s %14s\n" "stage" "frames" "insns/frame"
+for stage in $STAGES; do
+   read frames base < <(count $stage 0)
+   read frames total < <(count $stage $ITERATIONS)
+   if [ "$frames" -gt 0 ]; then
+      printf "%-8s %8d %14d\n" $stage $frames $(( (total - base) / (ITERATIONS * frames) ))
+   else
+      printf "%-8s %8d %14s\n" $stage 0 "-"
+   fi
+done
+
+# A soft-float or allocation regression shows up as call in the decoders
+echo
+echo "Calls to soft-float and allocation functions:"
+${CROSS}objdump -d $BENCH | awk -v decoders="$DECODERS" '
+   BEGIN { split(decoders, d); for (i in d) want[d[i]] = 1 }
+   /^[0-9a-f]+ <.*>:$/ { f = substr($2, 2, length($2) - 3); next }
+   want[f] && /\tb[a-z]*\t/ && /<(__aeabi_[fd]|__.*[sd]f[0-9]|malloc|calloc|realloc|free)/ {
+      sub(/.*</, "", $0); sub(/>.*/, "", $0); print "  " f " -> " $0; n++
+   }
+   END { if (!n) print "  none" }' | sort -u
@@ -21,6 +21,17 @@
    18-10-2013: Initial version (porting from arduino-DHT)
    17-03-2014: Added functions for sensor power switching
    11-11-2014: Added sensor reading via SPI interface
+   18-10-2026: Keep track of the time of the last sensor reading
+   18-10-2026: Added per sensor slots and read statistics
+   18-10-2026: Added tracing of sensor transactions
+   18-10-2026: Added capture handler for raw SPI line samples
+   18-10-2026: Store readings as integer values in tenths
+   18-10-2026: Added raw frame API
+   18-10-2026: Use the kernel IIO driver when available
+   18-10-2026: Update read schedule after each reading
+   18-10-2026: Evaluate thresholds after each reading
+   18-10-2026: Added I2C transport
+   18-10-2026: Sensor duty cycle per model, including the I2C sensors
 
  ******************************************************************
    
@@ -47,6 +58,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <time.h>
 
 #include "dht.h"
 
@@ -55,41 +67,218 @@
 #define GPIO_BASE_FILE "/sys/class/gpio/gpio"
 
 /* Global variables */
-float temperature;
-float humidity;
+int16_t temperature;  // 1/10 °C
+int16_t humidity;     // 1/10 %
+uint8_t raw_frame[DHT_FRAME_SIZE];  // latest valid data frame
 uint8_t data_pin;
+DHT_TRANSPORT_t transport;
 DHT_MODEL_t sensor_model;
 DHT_ERROR_t error_code;
 uint32_t last_read_time;
+DHT_CAPTURE_HANDLER_t capture_handler;
+
+/* Sensors known to the library (identified by transport and data pin,
+   0 for SPI, I2C bus number for I2C) */
+static struct {
+  uint8_t used;
+  uint8_t pin;
+  uint8_t transport;
+} sensor_slots[DHT_MAX_SENSORS];
 
 /* Imported functions */
+extern void dhtStatsBegin(void);
+extern void dhtStatsEnd(void);
+extern void dhtTraceBegin(void);
+extern void dhtTraceEnd(void);
+extern void dhtSchedUpdate(void);
+extern void dhtNotifyUpdate(void);
 extern void dhtSetup_gpio(uint8_t pin, DHT_MODEL_t model);
 extern void dhtCleanup_gpio(void);
 extern void readSensor_gpio();
 extern void dhtSetup_spi(DHT_MODEL_t model);
 extern void dhtCleanup_spi(void);
 extern void readSensor_spi();
+extern int dhtSetup_iio(uint8_t pin, DHT_MODEL_t model);
+extern void dhtCleanup_iio(void);
+extern void readSensor_iio();
+extern void dhtSetup_i2c(uint8_t bus, DHT_MODEL_t model);
+extern void dhtCleanup_i2c(void);
+extern void readSensor_i2c();
 
 
 /*********************************************************************
  * PUBLIC FUNCTIONS
  ********************************************************************/
 
+/*********************************************************************
+ * Function:    dhtMillis()
+ * 
+ * Description: Reads the monotonic system time (library internal)
+ * 
+ * Parameters:  none
+ * 
+ * Return:      time in milliseconds, never 0
+ * 
+ ********************************************************************/
+uint32_t dhtMillis(void)
+{
+  struct timespec now_ts;
+  uint32_t ms;
+  
+  clock_gettime(CLOCK_MONOTONIC, &now_ts);
+  ms = (uint32_t)now_ts.tv_sec*1000 + now_ts.tv_nsec/1000000;
+  
+  // 0 is reserved for "no previous reading" (see resetTimer())
+  return (ms ? ms : 1);
+}
+
+/*********************************************************************
+ * Function:    dhtMicros()
+ * 
+ * Description: Reads the monotonic system time (library internal)
+ * 
+ * Parameters:  none
+ * 
+ * Return:      time in microseconds (wraps around, use for time
+ *              differences only)
+ * 
+ ********************************************************************/
+uint32_t dhtMicros(void)
+{
+  struct timespec now_ts;
+  
+  clock_gettime(CLOCK_MONOTONIC, &now_ts);
+  return (uint32_t)now_ts.tv_sec*1000000 + now_ts.tv_nsec/1000;
+}
+
+/*********************************************************************
+ * Function:    dhtDutyCycle()
+ * 
+ * Description: Get the shortest interval between two readings of the
+ *              current sensor model (library internal)
+ *              - DHT11: max sample rate 1 Hz
+ *              - DHT22, AM2320: max sample rate 0.5 Hz, the AM2320
+ *                returns the result of the previous measurement when
+ *                read more often
+ *              - SHT3x: single shot measurement of max 15.5 ms, read
+ *                at most at 10 Hz (as its fastest periodic mode) to
+ *                keep self-heating low
+ * 
+ * Parameters:  none
+ * 
+ * Return:      duty cycle in ms
+ * 
+ ********************************************************************/
+uint32_t dhtDutyCycle(void)
+{
+  switch (sensor_model) {
+    case DHT11:     return 1000;
+    case SHT3X:
+    case SHT3X_ALT: return 100;
+    default:        return 2000;
+  }
+}
+
+/*********************************************************************
+ * Function:    dhtSensorSlot()
+ * 
+ * Description: Finds the slot of the current sensor (identified by 
+ *              its transport and data pin) used for per sensor health and
+ *              statistics tracking (library internal). A new slot is
+ *              allocated for a sensor seen for the first time. If all
+ *              slots are in use, the last one is shared.
+ * 
+ * Parameters:  none
+ * 
+ * Return:      index of the slot
+ * 
+ ********************************************************************/
+int dhtSensorSlot(void)
+{
+  int i;
+
+  for (i=0; i<DHT_MAX_SENSORS; i++) {
+    if (!sensor_slots[i].used) {
+      sensor_slots[i].used = 1;
+      sensor_slots[i].pin = data_pin;
+      sensor_slots[i].transport = transport;
+      return i;
+    }
+    if (sensor_slots[i].pin == data_pin && sensor_slots[i].transport == transport)
+      return i;
+  }
+  return DHT_MAX_SENSORS-1;
+}
+
+/*********************************************************************
+ * Function:    dhtSensorPin()
+ * 
+ * Description: Get the data pin of the sensor using the given slot 
+ *              (library internal)
+ * 
+ * Parameters:  slot - slot index
+ * 
+ * Return:      data pin, -1 if slot is not in use
+ * 
+ ********************************************************************/
+int dhtSensorPin(int slot)
+{
+  if (slot < 0 || slot >= DHT_MAX_SENSORS || !sensor_slots[slot].used)
+    return -1;
+  return sensor_slots[slot].pin;
+}
+
+/*********************************************************************
+ * Function:    dhtSensorTransport()
+ * 
+ * Description: Get the transport of the sensor using the given slot 
+ *              (library internal)
+ * 
+ * Parameters:  slot - slot index
+ * 
+ * Return:      transport, -1 if slot is not in use
+ * 
+ ********************************************************************/
+int dhtSensorTransport(int slot)
+{
+  if (slot < 0 || slot >= DHT_MAX_SENSORS || !sensor_slots[slot].used)
+    return -1;
+  return sensor_slots[slot].transport;
+}
+
 /*********************************************************************
  * Function: dhtSetup()
  * 
- * Description: Setup of globally used resources
+ * Description: Setup of globally used resources. A sensor on a GPIO
+ *              pin is read via the kernel IIO driver if the driver
+ *              handles this pin, otherwise via GPIO sysfs.
  * 
- * Parameters: pin - GPIO Kernel Id of used IO pin
+ * Parameters: pin - GPIO Kernel Id of used IO pin (0 for SPI),
+ *                   I2C bus number for I2C sensors
  *             model - sensors model
  * 
  ********************************************************************/
 void dhtSetup(uint8_t pin, DHT_MODEL_t model)
 {
-  if (pin)  
+  // Tracing can be enabled at runtime without changing the application
+  // (DHT_TRACE=1: record trace, DHT_TRACE=2: dump trace to stderr)
+  if (getenv("DHT_TRACE"))
+     dhtTraceEnable(atoi(getenv("DHT_TRACE")));
+  
+  if (model == AM2320 || model == SHT3X || model == SHT3X_ALT) {
+     transport = TRANSPORT_I2C;
+     dhtSetup_i2c(pin, model);
+  }
+  else if (pin && dhtSetup_iio(pin, model))
+     transport = TRANSPORT_IIO;
+  else if (pin) {
+     transport = TRANSPORT_GPIO;
      dhtSetup_gpio(pin, model);
-  else
+  }
+  else {
+     transport = TRANSPORT_SPI;
      dhtSetup_spi(model);
+  }
 }
 
 /*********************************************************************
@@ -102,10 +291,27 @@ void dhtSetup(uint8_t pin, DHT_MODEL_t model)
  ********************************************************************/
 void dhtCleanup(void)
 {
-  if (data_pin)
-     dhtCleanup_gpio();
-  else
-     dhtCleanup_spi();
+  switch (transport) {
+    case TRANSPORT_GPIO: dhtCleanup_gpio(); break;
+    case TRANSPORT_SPI:  dhtCleanup_spi();  break;
+    case TRANSPORT_IIO:  dhtCleanup_iio();  break;
+    case TRANSPORT_I2C:  dhtCleanup_i2c();  break;
+  }
+}
+
+/*********************************************************************
+ * Function:    getTransport()
+ * 
+ * Description: get the transport used for the current sensor
+ * 
+ * Parameters:  none
+ * 
+ * Return:      transport
+ * 
+ ********************************************************************/
+DHT_TRANSPORT_t getTransport()
+{
+  return transport;
 }
 
 /*********************************************************************
@@ -290,7 +496,7 @@ void resetTimer()
  ********************************************************************/
 float getHumidity()
 {
-  return humidity;
+  return humidity / 10.0f;
 }
 
 /*********************************************************************
@@ -304,6 +510,38 @@ float getHumidity()
  * 
  ********************************************************************/
 float getTemperature()
+{
+  return temperature / 10.0f;
+}
+
+/*********************************************************************
+ * Function:    getHumidityTenths()
+ * 
+ * Description: get humidity value read with latest readSensor()
+ *              (no floating point arithmetic involved)
+ * 
+ * Parameters:  none
+ * 
+ * Return:      relative humidity in 1/10 %
+ * 
+ ********************************************************************/
+int16_t getHumidityTenths()
+{
+  return humidity;
+}
+
+/*********************************************************************
+ * Function:    getTemperatureTenths()
+ * 
+ * Description: get temperature value read with latest readSensor()
+ *              (no floating point arithmetic involved)
+ * 
+ * Parameters:  none
+ * 
+ * Return:      temperature in 1/10 °C
+ * 
+ ********************************************************************/
+int16_t getTemperatureTenths()
 {
   return temperature;
 }
@@ -351,6 +589,22 @@ const char* getStatusString()
   }
 }
 
+/*********************************************************************
+ * Function:    dhtSetCaptureHandler()
+ * 
+ * Description: Set a function to be called with the raw line samples
+ *              of each sensor transaction (SPI mode only). The handler
+ *              is called after the transaction, before decoding.
+ *              In GPIO mode use the trace buffer to get the edges.
+ * 
+ * Parameters:  handler - capture handler, NULL to remove it
+ * 
+ ********************************************************************/
+void dhtSetCaptureHandler(DHT_CAPTURE_HANDLER_t handler)
+{
+  capture_handler = handler;
+}
+
 /*********************************************************************
  * Function:    readSensor()
  * 
@@ -363,11 +617,68 @@ const char* getStatusString()
  *              - error_code
  *              - temperature
  *              - humidity
+ *              - last_read_time
  ********************************************************************/
 void readSensor()
 {
-  if (data_pin) 
-     readSensor_gpio();
-  else
-     readSensor_spi();
+  dhtStatsBegin();
+  dhtTraceBegin();
+  
+  switch (transport) {
+    case TRANSPORT_GPIO: readSensor_gpio(); break;
+    case TRANSPORT_SPI:  readSensor_spi();  break;
+    case TRANSPORT_IIO:  readSensor_iio();  break;
+    case TRANSPORT_I2C:  readSensor_i2c();  break;
+  }
+  
+  dhtStatsEnd();
+  dhtTraceEnd();
+  
+  // the sensor duty cycle starts at the end of the transaction
+  last_read_time = dhtMillis();
+  dhtSchedUpdate();
+  dhtNotifyUpdate();
+}
+
+/*********************************************************************
+ * Function:    dhtReadRaw()
+ * 
+ * Description: reads the current sensor data like readSensor() but
+ *              returns the validated data frame without conversion
+ * 
+ * Parameters:  raw (out) - data frame, sensor model and timestamp
+ *                          (only valid if ERROR_NONE is returned)
+ * 
+ * Return:      error_code
+ ********************************************************************/
+DHT_ERROR_t dhtReadRaw(DHT_RAW_t *raw)
+{
+  readSensor();
+  
+  if (error_code == ERROR_NONE) {
+    memcpy(raw->frame, raw_frame, DHT_FRAME_SIZE);
+    raw->model = sensor_model;
+    raw->timestamp = last_read_time;
+  }
+  return error_code;
+}
+
+/*********************************************************************
+ * Function:    dhtConvertRaw()
+ * 
+ * Description: converts data frames read with dhtReadRaw() to
+ *              temperature and humidity values
+ * 
+ * Parameters:  raw (in)          - array of data frames
+ *              count (in)        - number of data frames
+ *              temperature (out) - array of temperatures in 1/10 °C
+ *              humidity (out)    - array of relative humidities in 1/10 %
+ * 
+ ********************************************************************/
+void dhtConvertRaw(const DHT_RAW_t *raw, int count, int16_t *temperature, int16_t *humidity)
+{
+  int i;
+  
+  for (i=0; i<count; i++)
+    dhtFrameToTenths(raw[i].frame, raw[i].model, &temperature[i], &humidity[i]);
 }
@@ -17,18 +17,68 @@
   Changelog:
    18-10-2013: Initial version (porting from arduino-DHT)
    17-03-2014: Added function prototypes for sensor power switching
+   18-10-2026: Added retry/recovery policy and sensor health tracking
+   18-10-2026: Added per read statistics and Prometheus metrics export
+   18-10-2026: Added trace buffer for the sensor transaction
+   18-10-2026: Added capture handler for raw SPI line samples
+   18-10-2026: Added protocol decoder for captured line samples
+   18-10-2026: Added integer API (values in tenths)
+   18-10-2026: Added raw frame API with deferred conversion
+   18-10-2026: Made header usable from C++
+   18-10-2026: Added transport using the kernel IIO driver
+   18-10-2026: Added adaptive read scheduler
+   18-10-2026: Added threshold notifications
+   18-10-2026: Added I2C sensors AM2320 and SHT3x
    
  ******************************************************************/
 
 #ifndef dht_h
 #define dht_h
 
+#include <stdio.h>
+#include <stdint.h>
+
+// Max number of sensors with individual health and statistics tracking
+#define DHT_MAX_SENSORS 8
+
+// Max number of registered thresholds
+#define DHT_MAX_THRESHOLDS 16
+
+// Size of a sensor data frame (humidity, temperature, checksum)
+#define DHT_FRAME_SIZE 5
+
+// Timing parameters of the protocol decoder (numbers are in microseconds)
+#define DHT_MAX_PULSE_ZERO 50    // 26-28us
+#define DHT_MAX_PULSE      120   // 70us for a one, 80us for the response
+
+// Thresholds of the HIGH pulse of a data bit in the SPI decoder, which
+// measures the pulses from the samples of the SPI controller
+#define DHT_SPI_MAX_PULSE_ZERO 40   // 26-28us
+#define DHT_SPI_MAX_PULSE_ONE  80   // 70us
+
+// Pulse width histogram: bin i counts pulses of (i*W, (i+1)*W] us,
+// the last bin counts all longer pulses
+#define DHT_PULSE_HIST_BINS  12
+#define DHT_PULSE_HIST_WIDTH 10
+
+// Directory of the IIO devices (can be changed with the environment
+// variable DHT_IIO_DIR)
+#define DHT_IIO_DIR "/sys/bus/iio/devices"
+
+// Directory of the GPIO chips, to find the Kernel Id of the data pin of
+// an IIO device (can be changed with the environment variable
+// DHT_GPIO_DIR)
+#define DHT_GPIO_DIR "/sys/class/gpio"
+
 typedef enum {
    AUTO_DETECT,
    DHT11,
    DHT22,
    AM2302,  // Packaged DHT22
-   RHT03    // Equivalent to DHT22
+   RHT03,   // Equivalent to DHT22
+   AM2320,  // I2C version of AM2302
+   SHT3X,   // Sensirion SHT30/31/35 at I2C address 0x44
+   SHT3X_ALT // Sensirion SHT30/31/35 at I2C address 0x45
 }
 DHT_MODEL_t;
 
@@ -40,6 +90,14 @@ typedef enum {
 }
 DHT_ERROR_t;
 
+typedef enum {
+   TRANSPORT_GPIO,  // GPIO sysfs, protocol timed in user space
+   TRANSPORT_SPI,   // SPI, protocol sampled by the SPI controller
+   TRANSPORT_IIO,   // kernel IIO dht11 driver
+   TRANSPORT_I2C    // I2C sensors
+}
+DHT_TRANSPORT_t;
+
 typedef enum {
    INPUT,
    OUTPUT
@@ -52,20 +110,216 @@ typedef enum {
 }
 PIN_STATE_t;
 
+typedef enum {
+   HEALTH_OK = 0,   // last read succeeded
+   HEALTH_DEGRADED, // sensor is failing, recovery in progress
+   HEALTH_DEAD      // sensor did not recover, stop reading it
+}
+DHT_HEALTH_t;
+
+/* Retry and recovery policy used by readSensorRetry() */
+typedef struct {
+   uint8_t  max_retries;      // retries per readSensorRetry() call
+   uint16_t timeout_backoff;  // delay after first TIMEOUT (ms), doubled on each further TIMEOUT
+   uint16_t max_backoff;      // upper limit for TIMEOUT backoff (ms)
+   uint8_t  reset_threshold;  // consecutive failures before sensor reset (0 = never)
+   uint8_t  dead_threshold;   // unsuccessful resets before sensor is declared dead (0 = never, needs power_pin)
+   uint8_t  power_pin;        // Kernel Id of GPIO power pin used for reset (0 = none)
+}
+DHT_POLICY_t;
+
+/* Parameters of the adaptive read scheduler (see dhtNextRead()) */
+typedef struct {
+   uint32_t max_interval;  // longest read interval (ms), 0: always read at the duty cycle
+   uint16_t temp_step;     // change of temperature to be detected (1/10 °C)
+   uint16_t humidity_step; // change of humidity to be detected (1/10 %)
+}
+DHT_SCHEDULE_t;
+
+typedef enum {
+   VALUE_TEMPERATURE,
+   VALUE_HUMIDITY
+}
+DHT_VALUE_t;
+
+/* Threshold with hysteresis on a reading (see dhtAddThreshold()) */
+typedef struct {
+   DHT_TRANSPORT_t transport; // transport of the sensor (see getTransport())
+   uint8_t         pin;   // data pin of the sensor (0 for SPI), I2C bus number
+   DHT_VALUE_t     value; // reading to watch
+   int16_t         high;  // value is ABOVE from here on (1/10 °C or %)
+   int16_t         low;   // value is BELOW from here on (1/10 °C or %)
+}
+DHT_THRESHOLD_t;
+
+typedef enum {
+   THRESHOLD_UNKNOWN = 0, // no valid reading yet
+   THRESHOLD_BELOW,
+   THRESHOLD_ABOVE
+}
+DHT_THRESHOLD_STATE_t;
+
+/* Per sensor health information */
+typedef struct {
+   uint32_t reads;            // total read attempts
+   uint32_t failures;         // total failed reads
+   uint32_t timeouts;         // total TIMEOUT errors
+   uint32_t checksums;        // total CHECKSUM errors
+   uint32_t resets;           // total sensor resets
+   uint16_t consecutive_failures;
+   uint8_t  failed_resets;    // resets not followed by a valid reading
+   DHT_HEALTH_t health;
+}
+DHT_HEALTH_INFO_t;
+
+typedef enum {
+   TRACE_OFF = 0,   // no tracing
+   TRACE_ON,        // record trace, retrieve with getTrace()
+   TRACE_DUMP       // record trace and dump it to stderr after each reading
+}
+DHT_TRACE_MODE_t;
+
+typedef enum {
+   TRACE_EDGE,      // edge detected on the data line
+   TRACE_START,     // host starts sending the start signal
+   TRACE_RELEASE,   // host releases the data line
+   TRACE_INPUT,     // host switched data line to input
+   TRACE_TIMEOUT,   // no edge detected within max pulse length
+   TRACE_CHECKSUM   // checksum error (value = received checksum)
+}
+DHT_TRACE_EVENT_t;
+
+/* Trace record of a single event in the sensor transaction */
+typedef struct {
+   uint32_t time;     // timestamp (us), only differences are meaningful
+   uint16_t value;    // samples polled before an edge, event specific otherwise
+   int8_t   edge;     // edge index (first 3 edges belong to the sensor response)
+   uint8_t  level;    // data line level after the event
+   uint8_t  event;    // DHT_TRACE_EVENT_t
+}
+DHT_TRACE_RECORD_t;
+
+/* Edge on the data line, input of the protocol decoder */
+typedef struct {
+   uint32_t time;     // us, only differences are meaningful
+   uint16_t samples;  // line samples taken since previous edge
+   uint8_t  level;    // line level after the edge
+}
+DHT_EDGE_t;
+
+/* Validated sensor data frame, to be converted later */
+typedef struct {
+   uint8_t  frame[DHT_FRAME_SIZE];  // humidity, temperature, checksum
+   uint8_t  model;                  // DHT_MODEL_t
+   uint32_t timestamp;              // time of reading (ms, monotonic)
+}
+DHT_RAW_t;
+
+/* Raw line samples of a sensor transaction in SPI mode */
+typedef struct {
+   uint32_t rate;         // sample rate (Hz)
+   uint32_t start;        // sample index where the host released the data line
+   uint32_t num_samples;
+   const uint8_t *data;   // line samples, one per bit (MSB first)
+}
+DHT_CAPTURE_t;
+
+typedef void (*DHT_CAPTURE_HANDLER_t)(const DHT_CAPTURE_t *capture);
+
+/* Handler doing an I2C transfer: write wlen bytes (if wbuf is not NULL),
+   then read rlen bytes (if rbuf is not NULL), return 0 or -errno */
+typedef int (*DHT_I2C_HANDLER_t)(uint8_t addr, const uint8_t *wbuf, int wlen,
+                                 uint8_t *rbuf, int rlen);
+
+/* Statistics of the latest sensor reading */
+typedef struct {
+   DHT_ERROR_t error;
+   uint32_t latency;          // duration of the whole reading (us)
+   uint32_t capture_time;     // time spent capturing the sensor response (us)
+   uint32_t samples;          // number of line samples taken
+   uint8_t  bits;             // number of data bits received
+   uint16_t margin;           // smallest distance of a data bit from the 0/1 threshold (us),
+                              // 0xFFFF if no data bit was received
+   uint8_t  retries;          // retries done by readSensorRetry()
+   uint8_t  resets;           // resets done by readSensorRetry()
+   uint16_t pulse_hist[DHT_PULSE_HIST_BINS]; // data bit pulse widths
+}
+DHT_READ_STATS_t;
+
+/* Accumulated statistics of all readings of a sensor */
+typedef struct {
+   uint32_t reads;
+   uint32_t errors[ERROR_OTHER+1]; // indexed by DHT_ERROR_t
+   uint64_t latency_sum;      // us
+   uint64_t capture_time_sum; // us
+   uint64_t samples;
+   uint32_t retries;
+   uint32_t pulses;
+   uint64_t pulse_sum;        // us
+   uint32_t pulse_hist[DHT_PULSE_HIST_BINS];
+   uint16_t min_margin;       // smallest margin of all readings (us)
+}
+DHT_STATS_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 void dhtSetup(uint8_t pin, DHT_MODEL_t model);
 void dhtCleanup();
+DHT_TRANSPORT_t getTransport();
 void resetTimer();
 void dhtPoweron(uint8_t pin);
 void dhtPoweroff(uint8_t pin);
 void dhtReset(uint8_t pin);
 
 void readSensor();
+DHT_ERROR_t dhtReadRaw(DHT_RAW_t *raw);
+void dhtConvertRaw(const DHT_RAW_t *raw, int count, int16_t *temperature, int16_t *humidity);
+
+void dhtSetPolicy(const DHT_POLICY_t *policy);
+void readSensorRetry();
+DHT_HEALTH_t getHealth();
+const DHT_HEALTH_INFO_t* getHealthInfo();
+void dhtClearHealth();
+
+void dhtSetSchedule(const DHT_SCHEDULE_t *schedule);
+uint32_t getReadInterval();
+uint32_t dhtNextRead();
+
+int dhtAddThreshold(const DHT_THRESHOLD_t *threshold);
+void dhtRemoveThreshold(int fd);
+DHT_THRESHOLD_STATE_t getThresholdState(int fd, int16_t *value);
+
+const DHT_READ_STATS_t* getReadStats();
+const DHT_STATS_t* getStats();
+int dhtWriteMetrics(const char *filename);
+
+void dhtTraceEnable(DHT_TRACE_MODE_t mode);
+int getTrace(DHT_TRACE_RECORD_t *records, int max);
+void dhtTraceDump(FILE *stream);
+
+void dhtSetCaptureHandler(DHT_CAPTURE_HANDLER_t handler);
+void dhtSetI2cHandler(DHT_I2C_HANDLER_t handler);
+
+int dhtSamplesToEdges(const uint32_t *times, const uint8_t *levels, int num_samples,
+                      DHT_EDGE_t *edges, int max_edges);
+DHT_ERROR_t dhtDecodeEdges(const DHT_EDGE_t *edges, int num_edges,
+                           uint8_t *frame, uint8_t *widths);
+void dhtFrameToTenths(const uint8_t *frame, DHT_MODEL_t model,
+                      int16_t *temperature, int16_t *humidity);
 
 float getTemperature();
 float getHumidity();
+int16_t getTemperatureTenths();
+int16_t getHumidityTenths();
 
 DHT_ERROR_t getStatus();
 const char* getStatusString();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /*dht_h*/
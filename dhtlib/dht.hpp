@@ -0,0 +1,481 @@
+/************************************************************************
+  DHT Temperature & Humidity Sensor library for use on Single Board
+  Computers (e.g. FoxG20, AriettaG25, RaspberryPi).
+
+  This is the header only C++ interface of the library. The sensor
+  model and the transport are template parameters of dht::Sensor, so
+  everything the C library decides at runtime (GPIO or SPI, DHT11 or
+  DHT22 timing and conversion) is resolved at compile time:
+
+    dht::Sensor<dht::Dht22, dht::Gpio> sensor(pin);
+    dht::Reading r = sensor.read();
+
+  The transport resources (exported GPIO pin, open file descriptors)
+  are owned by the sensor object and released by its destructor. The
+  sample buffers are members of the transport and sized for the model.
+  Constructors throw std::system_error if the transport can't be set
+  up, read() reports errors with the DHT_ERROR_t codes of the C API.
+
+  Nothing of this needs to be linked, only the types of dht.h are used.
+  Statistics, tracing and the retry policy of the C library are not
+  available here.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+
+ ******************************************************************/
+
+#ifndef dht_hpp
+#define dht_hpp
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "dht.h"
+
+namespace dht {
+
+/*********************************************************************
+ * SENSOR MODELS
+ *
+ * Timing parameters are in microseconds (duty cycle in milliseconds)
+ ********************************************************************/
+
+struct Dht11 {
+  static constexpr DHT_MODEL_t model = DHT11;
+  static constexpr uint32_t start_delay     = 20000;  // min 18ms
+  static constexpr uint32_t spi_start_delay = 12000;  // 30ms (12ms for Arietta)
+  static constexpr uint32_t capture_window  = 5500;   // 80+80us response, 40 bits of max 50+70us
+  static constexpr uint32_t max_pulse_zero  = DHT_MAX_PULSE_ZERO;
+  static constexpr uint32_t max_pulse_one   = DHT_MAX_PULSE;
+  static constexpr uint32_t max_pulse       = DHT_MAX_PULSE;
+  static constexpr uint32_t duty_cycle      = 1000;
+
+  // integral part only
+  static void convert(const uint8_t *frame, int16_t &temperature, int16_t &humidity)
+  {
+    humidity = frame[0] * 10;
+    temperature = frame[2] * 10;
+  }
+};
+
+struct Dht22 {
+  static constexpr DHT_MODEL_t model = DHT22;
+  static constexpr uint32_t start_delay     = 1000;   // min 800us
+  static constexpr uint32_t spi_start_delay = 800;    // 1.5ms (0.8ms for Arietta)
+  static constexpr uint32_t capture_window  = 5500;
+  static constexpr uint32_t max_pulse_zero  = DHT_MAX_PULSE_ZERO;
+  static constexpr uint32_t max_pulse_one   = DHT_MAX_PULSE;
+  static constexpr uint32_t max_pulse       = DHT_MAX_PULSE;
+  static constexpr uint32_t duty_cycle      = 2000;
+
+  // 16 bit values in 1/10, temperature with sign bit
+  static void convert(const uint8_t *frame, int16_t &temperature, int16_t &humidity)
+  {
+    humidity = (uint16_t)frame[0]<<8 | frame[1];
+    temperature = (uint16_t)(frame[2] & 0x7F)<<8 | frame[3];
+    if (frame[2] & 0x80)
+      temperature = -temperature;
+  }
+};
+
+// Packaged DHT22 and equivalent sensors
+typedef Dht22 Am2302;
+typedef Dht22 Rht03;
+
+// Data bit thresholds of the SPI decoder (as dht_spi.c)
+template<class Model>
+struct SpiTiming : Model {
+  static constexpr uint32_t max_pulse_zero  = DHT_SPI_MAX_PULSE_ZERO;
+  static constexpr uint32_t max_pulse_one   = DHT_SPI_MAX_PULSE_ONE;
+};
+
+
+/* Result of a sensor reading */
+struct Reading {
+  DHT_ERROR_t error;
+  int16_t temperature;           // 1/10 °C
+  int16_t humidity;              // 1/10 %
+  uint8_t frame[DHT_FRAME_SIZE]; // validated data frame
+};
+
+
+/*********************************************************************
+ * PROTOCOL DECODER
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    decode()
+ *
+ * Description: Decodes the sensor data frame from line samples,
+ *              starting at the sample taken after the host has
+ *              released the data line. Same algorithm as
+ *              dhtSamplesToEdges() and dhtDecodeEdges() in a single
+ *              pass, with the thresholds of the model. The SPI
+ *              transport uses SpiTiming<Model>, the thresholds of
+ *              dht_spi.c.
+ *
+ *              Samples must provide time(i) (us) and level(i).
+ *
+ * Parameters:  samples (in)     : line samples
+ *              first (in)       : index of the first sample
+ *              num_samples (in) : number of samples
+ *              frame (out)      : sensor data frame
+ *
+ * Return:      ERROR_NONE, ERROR_TIMEOUT or ERROR_CHECKSUM
+ *
+ ********************************************************************/
+template<class Model, class Samples>
+inline DHT_ERROR_t decode(const Samples &samples, int first, int num_samples,
+                          uint8_t *frame)
+{
+  int i, k = first;
+  uint32_t t, age;
+  int level;
+
+  for (i=0; i<DHT_FRAME_SIZE; i++)
+    frame[i] = 0;
+
+  if (first >= num_samples)
+    return ERROR_TIMEOUT;
+
+  t = samples.time(k);
+  level = samples.level(k);
+
+  // 3 edges of the sensor response, then 2 per data bit
+  for (i = -3; i < DHT_FRAME_SIZE*16; i++) {
+    // Level after edge i: LOW for odd i, HIGH for even i
+    if (level == (i & 1)) {
+      do {
+        if (++k >= num_samples)
+          return ERROR_TIMEOUT;
+      } while (samples.level(k) == level);
+      age = samples.time(k) - t;
+      if (age > ((i >= 0 && (i & 1)) ? Model::max_pulse_one : Model::max_pulse))
+        return ERROR_TIMEOUT;
+      t = samples.time(k);
+      level = !level;
+    }
+    else {
+      // level has already changed (edge missed by the sampling)
+      age = 0;
+    }
+
+    if (i >= 0 && (i & 1)) {
+      frame[i/16] <<= 1;
+      if (age > Model::max_pulse_zero)
+        frame[i/16] |= 1;
+    }
+  }
+
+  if ((uint8_t)(frame[0] + frame[1] + frame[2] + frame[3]) != frame[4])
+    return ERROR_CHECKSUM;
+
+  return ERROR_NONE;
+}
+
+/* Line samples taken with timestamps (GPIO transport) */
+struct TimedSamples {
+  const uint32_t *times;
+  const uint8_t  *levels;
+  uint32_t time(int i) const { return times[i]; }
+  int level(int i) const { return levels[i]; }
+};
+
+/* Line samples taken at a fixed rate, MSB first (SPI transport) */
+template<uint32_t Rate>
+struct BitSamples {
+  const uint8_t *data;
+  uint32_t time(int i) const { return (uint32_t)i * 1000 / (Rate / 1000); }
+  int level(int i) const { return (data[i/8] >> (7 - i%8)) & 1; }
+};
+
+template<class Model>
+inline DHT_ERROR_t decode(const uint32_t *times, const uint8_t *levels,
+                          int num_samples, uint8_t *frame)
+{
+  TimedSamples samples = { times, levels };
+  return decode<Model>(samples, 0, num_samples, frame);
+}
+
+
+/*********************************************************************
+ * TRANSPORTS
+ ********************************************************************/
+
+/* File descriptor owned by a transport */
+class Fd {
+public:
+  explicit Fd(int fd = -1) : fd(fd) { }
+  ~Fd() { if (fd >= 0) close(fd); }
+  Fd(const Fd&) = delete;
+  Fd& operator=(const Fd&) = delete;
+  int get() const { return fd; }
+private:
+  int fd;
+};
+
+inline void throwError(const char *what)
+{
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+/*********************************************************************
+ * Class:       Gpio
+ *
+ * Description: Data line on a GPIO pin, using GPIO sysfs. The pin is
+ *              exported for the lifetime of the object.
+ *
+ ********************************************************************/
+template<class Model>
+class Gpio {
+public:
+  // sample buffer for the capture window, at max one sample per 0.67us
+  static constexpr int max_samples = Model::capture_window * 3 / 2;
+
+  explicit Gpio(unsigned pin) : pin(pin)
+  {
+    char b[64];
+
+    writeFile("/sys/class/gpio/export", pin);
+    sysfsFilename(b, sizeof(b), "direction");
+    direction_fd = open(b, O_RDWR);
+    sysfsFilename(b, sizeof(b), "value");
+    value_fd = open(b, O_RDWR);
+    if (direction_fd < 0 || value_fd < 0) {
+      int err = errno;
+      cleanup();
+      errno = err;
+      throwError(b);
+    }
+  }
+
+  ~Gpio() { cleanup(); }
+
+  Gpio(const Gpio&) = delete;
+  Gpio& operator=(const Gpio&) = delete;
+
+  DHT_ERROR_t transfer(uint8_t *frame)
+  {
+    int n;
+
+    // Request sample
+    direction("out", 4);
+    write('1'); // Init
+    usleep(500000);
+    write('0'); // Send start signal
+    usleep(Model::start_delay);
+    write('1'); // Switch bus to receive data
+    direction("in", 3);
+
+    // Sample the sensor response, then decode it
+    uint32_t start = micros();
+    for (n=0; n<max_samples; n++) {
+      sample_time[n] = micros();
+      sample_level[n] = read();
+      if (sample_time[n] - start > Model::capture_window) {
+        n++;
+        break;
+      }
+    }
+    return decode<Model>(sample_time, sample_level, n, frame);
+  }
+
+private:
+  static uint32_t micros()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+  }
+
+  void sysfsFilename(char *filename, int len, const char *function)
+  {
+#ifdef AT91_SYSFS
+    snprintf(filename, len, "/sys/class/gpio/pio%c%u/%s", 'A'+pin/32, pin%32, function);
+#else
+    snprintf(filename, len, "/sys/class/gpio/gpio%u/%s", pin, function);
+#endif
+  }
+
+  static void writeFile(const char *filename, unsigned value)
+  {
+    char b[16];
+    Fd fd(open(filename, O_WRONLY));
+
+    if (fd.get() < 0)
+      throwError(filename);
+    snprintf(b, sizeof(b), "%u", value);
+    if (pwrite(fd.get(), b, strlen(b), 0) < 0)
+      throwError(filename);
+  }
+
+  void cleanup()
+  {
+    char b[16];
+    int fd;
+
+    if (value_fd >= 0) close(value_fd);
+    if (direction_fd >= 0) close(direction_fd);
+    fd = open("/sys/class/gpio/unexport", O_WRONLY);
+    if (fd >= 0) {
+      snprintf(b, sizeof(b), "%u", pin);
+      if (pwrite(fd, b, strlen(b), 0) < 0)
+        fprintf(stderr, "Unable to unexport pin=%u: %s\n", pin, strerror(errno));
+      close(fd);
+    }
+  }
+
+  void direction(const char *dir, int len)
+  {
+    if (pwrite(direction_fd, dir, len, 0) < 0)
+      fprintf(stderr, "Unable to pwrite to gpio direction for pin %u: %s\n",
+              pin, strerror(errno));
+  }
+
+  void write(char value)
+  {
+    if (pwrite(value_fd, &value, 1, 0) != 1)
+      fprintf(stderr, "Unable to pwrite %c to gpio value: %s\n",
+              value, strerror(errno));
+  }
+
+  uint8_t read()
+  {
+    char d = '0';
+
+    if (pread(value_fd, &d, 1, 0) != 1)
+      return 0;
+    return d != '0';
+  }
+
+  unsigned pin;
+  int direction_fd = -1;
+  int value_fd = -1;
+  uint32_t sample_time[max_samples];
+  uint8_t  sample_level[max_samples];
+};
+
+/*********************************************************************
+ * Class:       Spi
+ *
+ * Description: Data line on SPI MISO (see dht_spi.c for the wiring),
+ *              the SPI device is open for the lifetime of the object.
+ *
+ ********************************************************************/
+template<class Model>
+class Spi {
+public:
+  static constexpr uint32_t speed = 550000;
+  // start signal, then 6ms for the sensor response
+  static constexpr int num_bytes =
+    (uint64_t)(Model::spi_start_delay + 6000) * (speed / 1000) / 1000 / 8;
+  static constexpr int start_offset =
+    (uint64_t)Model::spi_start_delay * (speed / 1000) / 1000 / 8;
+
+  Spi() : fd(open("/dev/spidev0.0", O_RDWR))
+  {
+    uint8_t mode = SPI_MODE_0;
+    uint8_t bits = 8;
+    uint32_t max_speed = speed;
+
+    // SPI device name depends on the platform we are running on
+    if (fd < 0)
+      fd = open("/dev/spidev32766.0", O_RDWR);
+    if (fd < 0)
+      throwError("Can't open spi device");
+    if (ioctl(fd, SPI_IOC_WR_MODE, &mode) == -1 ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1 ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &max_speed) == -1) {
+      int err = errno;
+      close(fd);
+      errno = err;
+      throwError("Can't configure spi device");
+    }
+  }
+
+  ~Spi() { close(fd); }
+
+  Spi(const Spi&) = delete;
+  Spi& operator=(const Spi&) = delete;
+
+  DHT_ERROR_t transfer(uint8_t *frame)
+  {
+    struct spi_ioc_transfer tr;
+    BitSamples<speed> samples = { data };
+
+    // Low for the start signal, then high to wait for the response
+    memset(data, 0, start_offset);
+    memset(data + start_offset, 0xff, num_bytes - start_offset);
+
+    memset(&tr, 0, sizeof(tr));
+    tr.tx_buf = (unsigned long)data;
+    tr.rx_buf = (unsigned long)data;
+    tr.len = num_bytes;
+    tr.speed_hz = speed;
+    tr.bits_per_word = 8;
+    if (ioctl(fd, SPI_IOC_MESSAGE(1), &tr) < 0)
+      return ERROR_OTHER;
+
+    return decode< SpiTiming<Model> >(samples, start_offset*8, num_bytes*8, frame);
+  }
+
+private:
+  int fd;
+  uint8_t data[num_bytes];
+};
+
+
+/*********************************************************************
+ * Class:       Sensor
+ *
+ * Description: DHT sensor of the given model, connected via the given
+ *              transport. Constructor arguments are passed on to the
+ *              transport (GPIO: Kernel Id of the data pin).
+ *
+ ********************************************************************/
+template<class Model, template<class> class Transport>
+class Sensor {
+public:
+  typedef Model model_type;
+
+  template<class... Args>
+  explicit Sensor(Args&&... args) : bus(std::forward<Args>(args)...) { }
+
+  /*******************************************************************
+   * Function:    read()
+   *
+   * Description: handles the communication with the sensor and reads
+   *              the current sensor data. Don't call more often than
+   *              once per Model::duty_cycle.
+   *
+   * Return:      reading, temperature and humidity are 0 on error
+   *******************************************************************/
+  Reading read()
+  {
+    Reading r = Reading();
+
+    r.error = bus.transfer(r.frame);
+    if (r.error == ERROR_NONE)
+      Model::convert(r.frame, r.temperature, r.humidity);
+    return r;
+  }
+
+private:
+  Transport<Model> bus;
+};
+
+} // namespace dht
+
+#endif /*dht_hpp*/
@@ -0,0 +1,190 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the protocol decoder for captured line
+  samples. Capturing and decoding are done in two separate steps: the
+  transport only records the line samples of the sensor response as
+  fast as possible, the decoder then turns them into edges and the
+  edges into the sensor data frame. The decoder does not depend on the
+  transport, so it can also be used on recorded captures.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version (moved bit detection from dht_gpio.c)
+   18-10-2026: Added integer conversion of the data frame
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dht.h"
+
+#define RESPONSE_BITS  (DHT_FRAME_SIZE*8)
+#define RESPONSE_EDGES (RESPONSE_BITS*2)
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtSamplesToEdges()
+ *
+ * Description: Extracts the edges from a sequence of line samples.
+ *              The first sample is always stored as first edge, it
+ *              is the reference for the timing of the following ones.
+ *
+ * Parameters:  times (in)     : sample timestamps (us)
+ *              levels (in)    : sample levels
+ *              num_samples (in): number of samples
+ *              edges (out)    : buffer for edges
+ *              max_edges (in) : size of edges buffer
+ *
+ * Return:      number of edges
+ *
+ ********************************************************************/
+int dhtSamplesToEdges(const uint32_t *times, const uint8_t *levels, int num_samples,
+                      DHT_EDGE_t *edges, int max_edges)
+{
+  int i, n = 0;
+  uint16_t samples = 0;
+
+  if (num_samples == 0 || max_edges == 0)
+    return 0;
+
+  edges[n].time = times[0];
+  edges[n].level = levels[0];
+  edges[n].samples = 0;
+  n++;
+
+  for (i=1; i<num_samples && n<max_edges; i++) {
+    if (samples < 0xFFFF)
+      samples++;
+    if (levels[i] != edges[n-1].level) {
+      edges[n].time = times[i];
+      edges[n].level = levels[i];
+      edges[n].samples = samples;
+      samples = 0;
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/*********************************************************************
+ * Function:    dhtDecodeEdges()
+ *
+ * Description: Decodes the sensor data frame from the edges on the
+ *              data line after the host has released it.
+ *
+ *              We're expecting 83 edges:
+ *              - First a FALLING, RISING, and FALLING edge for the
+ *                start bit
+ *              - Then 40 bits: RISING and then a FALLING edge per bit
+ *              Any HIGH or LOW level must not be longer than
+ *              DHT_MAX_PULSE, the bit value is given by the length
+ *              of the HIGH level.
+ *
+ * Parameters:  edges (in)     : edges, the first one being the time
+ *                               reference (host released data line)
+ *              num_edges (in) : number of edges
+ *              frame (out)    : sensor data frame (DHT_FRAME_SIZE bytes)
+ *              widths (out)   : HIGH level length of each data bit
+ *                               (40 bytes, 0 for bits not received, 
+ *                               may be NULL)
+ *
+ * Return:      ERROR_NONE, ERROR_TIMEOUT if edges are missing or too
+ *              far apart, ERROR_CHECKSUM on checksum mismatch
+ *
+ ********************************************************************/
+DHT_ERROR_t dhtDecodeEdges(const DHT_EDGE_t *edges, int num_edges,
+                           uint8_t *frame, uint8_t *widths)
+{
+  int i, e = 0;
+  uint32_t t;
+  uint32_t age;
+  uint8_t level;
+  uint8_t checksum;
+
+  for (i=0; i<DHT_FRAME_SIZE; i++)
+    frame[i] = 0;
+  if (widths)
+    memset(widths, 0, RESPONSE_BITS);
+
+  if (num_edges == 0)
+    return ERROR_TIMEOUT;
+
+  t = edges[0].time;
+  level = edges[0].level;
+
+  for (i = -3; i < RESPONSE_EDGES; i++) {
+    // Level after edge i: LOW for odd i, HIGH for even i
+    if (level == (i & 1)) {
+      // wait for the next edge
+      if (++e >= num_edges)
+        return ERROR_TIMEOUT;
+      age = edges[e].time - t;
+      if (age > DHT_MAX_PULSE)
+        return ERROR_TIMEOUT;
+      t = edges[e].time;
+      level = edges[e].level;
+    }
+    else {
+      // level has already changed (edge missed by the sampling)
+      age = 0;
+    }
+
+    if (i >= 0 && (i & 1)) {
+      // Now we are being fed our 40 bits
+      // A zero lasts max 30 usecs, a one at least 68 usecs.
+      frame[i/16] <<= 1;
+      if (age > DHT_MAX_PULSE_ZERO)
+        frame[i/16] |= 1;
+      if (widths)
+        widths[i/2] = age;
+    }
+  }
+
+  // Verify checksum
+  checksum = frame[0] + frame[1] + frame[2] + frame[3];
+  if (checksum != frame[4])
+    return ERROR_CHECKSUM;
+
+  return ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    dhtFrameToTenths()
+ *
+ * Description: Converts a sensor data frame to temperature and
+ *              humidity values using integer arithmetic only
+ *
+ * Parameters:  frame (in)        : sensor data frame
+ *              model (in)        : sensor model
+ *              temperature (out) : temperature in 1/10 °C
+ *              humidity (out)    : relative humidity in 1/10 %
+ *
+ ********************************************************************/
+void dhtFrameToTenths(const uint8_t *frame, DHT_MODEL_t model,
+                      int16_t *temperature, int16_t *humidity)
+{
+  if (model == DHT11) {
+    // integral part only
+    *humidity = frame[0] * 10;
+    *temperature = frame[2] * 10;
+  }
+  else {
+    // 16 bit values in 1/10, temperature with sign bit
+    *humidity = (uint16_t)frame[0]<<8 | frame[1];
+    *temperature = (uint16_t)(frame[2] & 0x7F)<<8 | frame[3];
+    if (frame[2] & 0x80)
+      *temperature = -*temperature;
+  }
+}
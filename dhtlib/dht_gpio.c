@@ -22,6 +22,13 @@
    24-11-2014: Changed handling of sysfs filenames to support different 
                namig schemes used by various micro processors and
                kernel versions
+   18-10-2026: Added collection of read statistics
+   18-10-2026: Replaced debug printouts by trace records
+   18-10-2026: Fixed micros() wrap around at second boundaries
+   18-10-2026: Separated sampling of the sensor response from decoding
+   18-10-2026: Use integer conversion of readings
+   18-10-2026: Keep the validated data frame
+   18-10-2026: Skip the init delay when the line has been idle long enough
                
 ************************************************************************/
 
@@ -35,9 +42,7 @@
 #include <stdint.h>
 
 #include "dht.h"
-
-// Debug mode: set to 1 to print debug information
-#define DEBUG 0
+#include "dht_trace.h"
 
 // For systems not using the standard GPIO sysfs naming scheme
 // /sys/class/gpio/gpio<N> 
@@ -48,28 +53,38 @@
 #define EXPORT_FILE    "/sys/class/gpio/export"
 #define UNEXPORT_FILE  "/sys/class/gpio/unexport"
 
-// timing parameters for serial bit detection
+// timing parameters for sensor response sampling
 // (numbers are in microseconds)
-#define MAX_PULSE_LENGTH_ZERO 50 // 26-28us
-#define MAX_PULSE_LENGTH_ONE 120 // 70us
-#define MAX_BIT_LENGTH MAX_PULSE_LENGTH_ONE
+#define CAPTURE_WINDOW 5500      // 80+80us response, 40 bits of max 50+70us
+#define MAX_SAMPLES 8192         // sample buffer size
+#define MAX_EDGES 128            // 83 edges expected
 #define MAX_RESPONSE_BITS 40     // 5 bytes
-#define MAX_RESPONSE_EDGES MAX_RESPONSE_BITS*2
 #define INIT_DELAY 500000
 #define DHT11_START_DELAY 20*1000  // min 18ms
 #define DHT22_START_DELAY 1000     // min 800us
 
 /* Imported variables */
-extern float temperature;
-extern float humidity;
+extern int16_t temperature;
+extern int16_t humidity;
+extern uint8_t raw_frame[DHT_FRAME_SIZE];
 extern uint8_t data_pin;
 extern DHT_MODEL_t sensor_model;
 extern DHT_ERROR_t error_code;
 extern uint32_t last_read_time;
 
+/* Imported functions */
+extern uint32_t dhtMillis(void);
+extern void dhtStatsCapture(uint32_t capture_time, uint32_t samples);
+extern void dhtStatsPulse(uint16_t width, uint16_t threshold);
+
 static int value_fd;
 static int direction_fd;
 
+/* Buffers for the sampled sensor response */
+static uint32_t sample_time[MAX_SAMPLES];
+static uint8_t  sample_level[MAX_SAMPLES];
+static DHT_EDGE_t edges[MAX_EDGES];
+
 
 /*********************************************************************
  * INTERNAL FUNCTIONS
@@ -147,13 +162,12 @@ static PIN_STATE_t digitalRead(void)
  * 
  * Parameters:  none
  * 
- * Return:      The microsseconds part of the current time 
+ * Return:      The current monotonic time in microseconds (wraps
+ *              around, use for time differences only)
  * 
  ********************************************************************/
-static long micros(void)
+static uint32_t micros(void)
 {
-  static long first = -1;
-  long nsec;
   struct timespec now_ts;
   
 
@@ -164,17 +178,8 @@ static long micros(void)
       return 0;
   }
   
-  // store first reading
-  if (first == -1) first=now_ts.tv_nsec;
-  
-  // check for zero crossing of nano seconds
-  if (now_ts.tv_nsec < first) 
-    nsec=now_ts.tv_nsec+1000000;
-  else
-    nsec=now_ts.tv_nsec;
-  
   // convert to micro seconds
-  return nsec/1000;
+  return (uint32_t)now_ts.tv_sec*1000000 + now_ts.tv_nsec/1000;
 }
 
 /*********************************************************************
@@ -232,6 +237,35 @@ static void sysfs_filename(char *filename, int len, int pin, const char *functio
 #endif
   // Note: might need to add more naming schemes here
 }
+
+/*********************************************************************
+ * Function:    capture_response()
+ * 
+ * Description: Samples the data line for the duration of the sensor
+ *              response. The loop does nothing but store the samples,
+ *              to get the highest possible sample rate. Decoding is 
+ *              done afterwards.
+ * 
+ * Parameters:  none
+ * 
+ * Return:      number of samples
+ * 
+ ********************************************************************/
+static int capture_response(void)
+{
+  uint32_t start = micros();
+  int n;
+  
+  for (n=0; n<MAX_SAMPLES; n++) {
+    sample_time[n] = micros();
+    sample_level[n] = digitalRead();
+    if (sample_time[n] - start > CAPTURE_WINDOW) {
+      n++;
+      break;
+    }
+  }
+  return n;
+}
   
 
 /*********************************************************************
@@ -364,30 +398,18 @@ void dhtCleanup_gpio(void)
  ********************************************************************/
 void readSensor_gpio()
 {
-  long startTime = micros();
-  int8_t   i; 
-  uint32_t k;
-  uint8_t  age;
-  uint16_t rawHumidity=0;
-  uint16_t rawTemperature=0;
-  uint16_t data=0;
-#if DEBUG
-  long t1, t2, t3, t4; // debug info
-#endif
-
+  int i;
+  int num_samples;
+  int num_edges;
+  uint8_t  frame[DHT_FRAME_SIZE];
+  uint8_t  width[MAX_RESPONSE_BITS];
+  uint32_t idle = 0;
+
+  // The data line has been released (HIGH) since the last reading
+  if (last_read_time)
+    idle = dhtMillis() - last_read_time;
   last_read_time = 0;
 
-#if 0
-  // Make sure we don't poll the sensor too often
-  // - Max sample rate DHT11 is 1 Hz   (duty cicle 1000 ms)
-  // - Max sample rate DHT22 is 0.5 Hz (duty cicle 2000 ms)
-  unsigned long startTime = micros();
-  if ( (unsigned long)(startTime - last_read_time) < (model == DHT11 ? 999L : 1999L) ) {
-    return;
-  }
-  last_read_time = startTime;
-#endif
-
   temperature = 0;
   humidity = 0;
 
@@ -397,12 +419,11 @@ void readSensor_gpio()
   // Request sample
   pinMode(OUTPUT);  
   digitalWrite(HIGH); // Init
-  usleep(INIT_DELAY);
+  if (idle < INIT_DELAY/1000)
+    usleep(INIT_DELAY - idle*1000);
   
   digitalWrite(LOW); // Send start signal
-#if DEBUG
-  t1 = micros(); 
-#endif
+  TRACE(TRACE_START, micros(), 0, LOW, 0);
   if ( sensor_model == DHT11 ) {
     usleep(DHT11_START_DELAY);
   }
@@ -412,88 +433,35 @@ void readSensor_gpio()
   }
   
   digitalWrite(HIGH); // Switch bus to receive data
-#if DEBUG
-  t2 = micros(); 
-#endif
+  TRACE(TRACE_RELEASE, micros(), 0, HIGH, 0);
   pinMode(INPUT);
-#if DEBUG
-  t3 = micros(); 
-#endif
 
-  // We're going to read 83 edges:
-  // - First a FALLING, RISING, and FALLING edge for the start bit
-  // - Then 40 bits: RISING and then a FALLING edge per bit
-  // To keep our code simple, we accept any HIGH or LOW reading if it's max 85 usecs long
+  // Sample the sensor response, then decode it
+  num_samples = capture_response();
+  num_edges = dhtSamplesToEdges(sample_time, sample_level, num_samples, edges, MAX_EDGES);
+  error_code = dhtDecodeEdges(edges, num_edges, frame, width);
   
-  for ( i = -3 ; i < MAX_RESPONSE_EDGES; i++ ) {
-    startTime = micros();
-
-    // wait for edge change and measure pulse length
-    k=0;
-    do {
-      k++;
-      age = (uint8_t)(micros() - startTime);
-      if ( age > MAX_BIT_LENGTH ) {
-        // pulse length for single bit has timed out
-#if DEBUG
-        t4 = micros(); 
-        printf("i=%d, k=%lu, age=%u, data_pin=%u, data=0x%08X\n", 
-                i, (long unsigned int)k, age, digitalRead(), data);
-        printf("dt2=%ld, dt3=%ld, dt4=%ld\n", t2-t1, t3-t2, t4-t3);
-#endif
-        error_code = ERROR_TIMEOUT;
-        return;
-      }
-      // sleep 10us
-      //usleep(10);
-    }
-    while ( digitalRead() == (i & 1) ? HIGH : LOW );
-    
-    if ( i >= 0 && (i & 1) ) {
-      // Now we are being fed our 40 bits
-      data <<= 1;
-
-      // A zero lasts max 30 usecs, a one at least 68 usecs.
-      if ( age > MAX_PULSE_LENGTH_ZERO ) {
-        data |= 1; // we got a one
-      }
-    }
-
-    switch ( i ) {
-      case 31:
-        rawHumidity = data;
-        data = 0;
-        break;
-      case 63:
-        rawTemperature = data;
-        data = 0;
-        break;
-    }
+  // Statistics and trace are collected after the time critical part
+  dhtStatsCapture(sample_time[num_samples-1] - sample_time[0], num_samples);
+  TRACE(TRACE_INPUT, sample_time[0], 0, sample_level[0], 0);
+  for (i=1; i<num_edges; i++)
+    TRACE(TRACE_EDGE, edges[i].time, i-4, edges[i].level, edges[i].samples);
+  
+  if ( error_code == ERROR_TIMEOUT ) {
+    TRACE(TRACE_TIMEOUT, sample_time[num_samples-1], num_edges-4, sample_level[num_samples-1], 0);
+    for (i=0; i<MAX_RESPONSE_BITS && width[i]; i++)
+      dhtStatsPulse(width[i], DHT_MAX_PULSE_ZERO);
+    return;
   }
+  for (i=0; i<MAX_RESPONSE_BITS; i++)
+    dhtStatsPulse(width[i], DHT_MAX_PULSE_ZERO);
   
-  // Verify checksum
-  if ( (uint8_t)(((uint8_t)rawHumidity) + (rawHumidity >> 8) + ((uint8_t)rawTemperature) + (rawTemperature >> 8)) != data ) {
-#if DEBUG
-    printf("data_pin=%d, data=0x%04X%04X%02X\n", 
-            digitalRead(), rawHumidity, rawTemperature, data);
-#endif
-    error_code = ERROR_CHECKSUM;
+  if ( error_code == ERROR_CHECKSUM ) {
+    TRACE(TRACE_CHECKSUM, sample_time[num_samples-1], num_edges-4, sample_level[num_samples-1], frame[4]);
     return;
   }
 
   // Convert raw readings and store in global variables
-  if ( sensor_model == DHT11 ) {
-    humidity = rawHumidity >> 8;
-    temperature = rawTemperature >> 8;
-  }
-  else {
-    humidity = rawHumidity * 0.1;
-
-    if ( rawTemperature & 0x8000 ) {
-      rawTemperature = -(int16_t)(rawTemperature & 0x7FFF);
-    }
-    temperature = ((int16_t)rawTemperature) * 0.1;
-  }
-
-  error_code = ERROR_NONE;
+  memcpy(raw_frame, frame, DHT_FRAME_SIZE);
+  dhtFrameToTenths(frame, sensor_model, &temperature, &humidity);
 }
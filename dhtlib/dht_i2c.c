@@ -0,0 +1,395 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the sensor reading functions for I2C
+  temperature and humidity sensors:
+  - AM2320 (I2C version of the AM2302/DHT22)
+  - Sensirion SHT30/SHT31/SHT35
+
+  The sensors are read via the I2C dev interface (/dev/i2c-N, kernel
+  module i2c-dev) with plain I2C transfers (I2C_RDWR), so the adapter
+  must support I2C_FUNC_I2C. A complete reading takes a few ms and no
+  busy waiting. The I2C transfers can be replaced by a handler (see
+  dhtSetI2cHandler()), e.g. to test with a mock device.
+
+  The bus number is given as pin to dhtSetup(). The readings are stored
+  in 1/10 like for the DHT sensors and the data frame returned by
+  dhtReadRaw() has the DHT22 format.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "dht.h"
+
+#define I2C_DEV_FILE "/dev/i2c-%d"
+
+// I2C addresses
+#define AM2320_ADDR     0x5C
+#define SHT3X_ADDR      0x44   // ADDR pin low
+#define SHT3X_ALT_ADDR  0x45   // ADDR pin high
+
+// AM2320: read 4 registers from 0x00 (humidity, temperature)
+#define AM2320_READ_REGS    0x03
+#define AM2320_RSP_SIZE     8  // function, count, 4 data bytes, CRC16
+#define AM2320_WAKEUP_DELAY 1000   // 0.8-3 ms
+#define AM2320_READ_DELAY   2000   // min 1.5 ms
+
+// SHT3x: single shot, high repeatability, no clock stretching
+#define SHT3X_MEASURE_HI  0x24
+#define SHT3X_MEASURE_LO  0x00
+#define SHT3X_RSP_SIZE    6    // temperature, CRC8, humidity, CRC8
+#define SHT3X_MEASURE_DELAY 16000  // max 15 ms
+
+/* Imported variables */
+extern int16_t temperature;
+extern int16_t humidity;
+extern uint8_t raw_frame[DHT_FRAME_SIZE];
+extern uint8_t data_pin;
+extern DHT_MODEL_t sensor_model;
+extern DHT_ERROR_t error_code;
+extern uint32_t last_read_time;
+
+/* Imported functions */
+extern uint32_t dhtMicros(void);
+extern void dhtStatsCapture(uint32_t capture_time, uint32_t samples);
+
+static int fd = -1;
+static uint8_t address;
+static DHT_I2C_HANDLER_t i2c_handler;
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    i2c_transfer()
+ *
+ * Description: Writes and/or reads data to/from the sensor, each in
+ *              its own I2C message
+ *
+ * Parameters:  wbuf (in)  : data to write (NULL for none)
+ *              wlen (in)  : number of bytes to write
+ *              rbuf (out) : buffer for data to read (NULL for none)
+ *              rlen (in)  : number of bytes to read
+ *
+ * Return:      0 on success, -errno on error
+ *
+ ********************************************************************/
+static int i2c_transfer(const uint8_t *wbuf, int wlen, uint8_t *rbuf, int rlen)
+{
+  struct i2c_msg msgs[2];
+  struct i2c_rdwr_ioctl_data data = { msgs, 0 };
+
+  if (i2c_handler)
+    return i2c_handler(address, wbuf, wlen, rbuf, rlen);
+
+  if (wbuf) {
+    msgs[data.nmsgs].addr = address;
+    msgs[data.nmsgs].flags = 0;
+    msgs[data.nmsgs].len = wlen;
+    msgs[data.nmsgs].buf = (uint8_t*)wbuf;
+    data.nmsgs++;
+  }
+  if (rbuf) {
+    msgs[data.nmsgs].addr = address;
+    msgs[data.nmsgs].flags = I2C_M_RD;
+    msgs[data.nmsgs].len = rlen;
+    msgs[data.nmsgs].buf = rbuf;
+    data.nmsgs++;
+  }
+
+  if (ioctl(fd, I2C_RDWR, &data) < 0)
+    return -errno;
+  return 0;
+}
+
+/*********************************************************************
+ * Function:    transfer_error()
+ *
+ * Description: Maps the error of an I2C transfer to the error code of
+ *              the reading: a sensor which does not acknowledge its
+ *              address is handled like a DHT sensor not responding
+ *
+ ********************************************************************/
+static DHT_ERROR_t transfer_error(int err)
+{
+  return (err == -ENXIO || err == -EREMOTEIO ? ERROR_TIMEOUT : ERROR_OTHER);
+}
+
+/*********************************************************************
+ * Function:    crc16()
+ *
+ * Description: Calculates the CRC of an AM2320 response (CRC-16/MODBUS)
+ *
+ ********************************************************************/
+static uint16_t crc16(const uint8_t *data, int len)
+{
+  uint16_t crc = 0xFFFF;
+  int i;
+
+  while (len--) {
+    crc ^= *data++;
+    for (i=0; i<8; i++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return crc;
+}
+
+/*********************************************************************
+ * Function:    crc8()
+ *
+ * Description: Calculates the CRC of an SHT3x data word
+ *              (polynomial 0x31, init 0xFF)
+ *
+ ********************************************************************/
+static uint8_t crc8(const uint8_t *data, int len)
+{
+  uint8_t crc = 0xFF;
+  int i;
+
+  while (len--) {
+    crc ^= *data++;
+    for (i=0; i<8; i++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+  return crc;
+}
+
+/*********************************************************************
+ * Function:    read_am2320()
+ *
+ * Description: Reads an AM2320. The sensor sleeps between readings
+ *              and does not acknowledge the wake up transfer.
+ *
+ * Return:      error code
+ *
+ ********************************************************************/
+static DHT_ERROR_t read_am2320(void)
+{
+  static const uint8_t request[] = { AM2320_READ_REGS, 0x00, 0x04 };
+  uint8_t rsp[AM2320_RSP_SIZE];
+  uint16_t t;
+  int ret;
+
+  // Wake up the sensor
+  i2c_transfer(request, 0, NULL, 0);
+  usleep(AM2320_WAKEUP_DELAY);
+
+  ret = i2c_transfer(request, sizeof(request), NULL, 0);
+  if (ret < 0)
+    return transfer_error(ret);
+  usleep(AM2320_READ_DELAY);
+
+  ret = i2c_transfer(NULL, 0, rsp, sizeof(rsp));
+  if (ret < 0)
+    return transfer_error(ret);
+
+  // CRC is sent LSB first
+  if (crc16(rsp, 6) != (rsp[7]<<8 | rsp[6]) ||
+      rsp[0] != AM2320_READ_REGS || rsp[1] != 4)
+    return ERROR_CHECKSUM;
+
+  // Same format as DHT22: 1/10, temperature with sign bit
+  humidity = rsp[2]<<8 | rsp[3];
+  t = rsp[4]<<8 | rsp[5];
+  temperature = (t & 0x8000) ? -(int16_t)(t & 0x7FFF) : (int16_t)t;
+  return ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    read_sht3x()
+ *
+ * Description: Reads an SHT3x with a single shot measurement
+ *
+ * Return:      error code
+ *
+ ********************************************************************/
+static DHT_ERROR_t read_sht3x(void)
+{
+  static const uint8_t command[] = { SHT3X_MEASURE_HI, SHT3X_MEASURE_LO };
+  uint8_t rsp[SHT3X_RSP_SIZE];
+  uint32_t raw;
+  int ret;
+
+  ret = i2c_transfer(command, sizeof(command), NULL, 0);
+  if (ret < 0)
+    return transfer_error(ret);
+  usleep(SHT3X_MEASURE_DELAY);
+
+  // the sensor NACKs the read until the measurement is done
+  ret = i2c_transfer(NULL, 0, rsp, sizeof(rsp));
+  if (ret < 0)
+    return transfer_error(ret);
+
+  if (crc8(&rsp[0], 2) != rsp[2] || crc8(&rsp[3], 2) != rsp[5])
+    return ERROR_CHECKSUM;
+
+  // T = -45 + 175 * raw / 65535 °C, RH = 100 * raw / 65535 %
+  raw = rsp[0]<<8 | rsp[1];
+  temperature = (int32_t)(1750 * raw + 32767) / 65535 - 450;
+  raw = rsp[3]<<8 | rsp[4];
+  humidity = (1000 * raw + 32767) / 65535;
+  return ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    make_frame()
+ *
+ * Description: Builds a sensor data frame in DHT22 format for the
+ *              reading
+ *
+ * Parameters:  frame (out) : sensor data frame
+ *
+ ********************************************************************/
+static void make_frame(uint8_t *frame)
+{
+  uint16_t t = (temperature < 0 ? -temperature : temperature);
+
+  frame[0] = humidity >> 8;
+  frame[1] = humidity & 0xFF;
+  frame[2] = (t >> 8) | (temperature < 0 ? 0x80 : 0);
+  frame[3] = t & 0xFF;
+  frame[4] = frame[0] + frame[1] + frame[2] + frame[3];
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function: dhtSetup_i2c()
+ *
+ * Description: Setup of globally used resources
+ *
+ * Parameters: bus - I2C bus number
+ *             model - sensors model
+ *
+ ********************************************************************/
+void dhtSetup_i2c(uint8_t bus, DHT_MODEL_t model)
+{
+  char b[64];
+  unsigned long funcs;
+
+  // store globals
+  data_pin = bus;
+  sensor_model = model;
+  resetTimer();
+
+  switch (model) {
+    case AM2320:    address = AM2320_ADDR; break;
+    case SHT3X:     address = SHT3X_ADDR; break;
+    case SHT3X_ALT: address = SHT3X_ALT_ADDR; break;
+    default:
+      fprintf(stderr, "ERROR: Sensor model %d is not an I2C sensor\n", model);
+      error_code = ERROR_OTHER;
+      return;
+  }
+
+  if (i2c_handler) {
+    error_code = ERROR_NONE;
+    return;
+  }
+
+  snprintf(b, sizeof(b), I2C_DEV_FILE, bus);
+  fd = open(b, O_RDWR);
+  if (fd < 0) {
+    fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+    error_code = ERROR_OTHER;
+    return;
+  }
+
+  if (ioctl(fd, I2C_FUNCS, &funcs) < 0 || !(funcs & I2C_FUNC_I2C)) {
+    fprintf(stderr, "ERROR: %s does not support plain I2C transfers\n", b);
+    close(fd);
+    fd = -1;
+    error_code = ERROR_OTHER;
+    return;
+  }
+
+  error_code = ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    dhtCleanup_i2c()
+ *
+ * Description: Cleanup of globally used resources
+ *
+ * Parameters:  none
+ *
+ ********************************************************************/
+void dhtCleanup_i2c(void)
+{
+  if (fd >= 0) close(fd);
+  fd = -1;
+  error_code = ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    readSensor_i2c()
+ *
+ * Description: reads the current sensor data via I2C
+ *
+ * Parameters:  none
+ *
+ * Return:      sets the following global variables:
+ *              - error_code
+ *              - temperature
+ *              - humidity
+ ********************************************************************/
+void readSensor_i2c()
+{
+  uint32_t capture_time;
+
+  temperature = 0;
+  humidity = 0;
+
+  capture_time = dhtMicros();
+  if (sensor_model == AM2320)
+    error_code = read_am2320();
+  else
+    error_code = read_sht3x();
+  dhtStatsCapture(dhtMicros() - capture_time, 0);
+
+  if (error_code != ERROR_NONE) {
+    temperature = 0;
+    humidity = 0;
+    return;
+  }
+
+  // Build data frame for dhtReadRaw()
+  make_frame(raw_frame);
+}
+
+/*********************************************************************
+ * Function:    dhtSetI2cHandler()
+ *
+ * Description: Set a function to do the I2C transfers instead of the
+ *              I2C dev interface, e.g. a mock device for testing.
+ *              Must be set before dhtSetup().
+ *
+ * Parameters:  handler - I2C transfer handler, NULL to remove it
+ *
+ ********************************************************************/
+void dhtSetI2cHandler(DHT_I2C_HANDLER_t handler)
+{
+  i2c_handler = handler;
+}
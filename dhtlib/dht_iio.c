@@ -0,0 +1,380 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the DHT sensor reading functions using
+  the dht11 IIO driver of the Linux kernel (drivers/iio/humidity/dht11.c,
+  supports DHT11 and DHT22). The driver times the protocol in interrupt
+  context and provides the readings in sysfs:
+
+    <iio dir>/iio:deviceN/name                       "dht11"
+    <iio dir>/iio:deviceN/in_temp_input              1/1000 °C
+    <iio dir>/iio:deviceN/in_humidityrelative_input  1/1000 %
+    <iio dir>/iio:deviceN/of_node/gpios              data pin (DT cells)
+
+  The device is selected by the data pin given to dhtSetup(). The pin of
+  the device tree node is given as GPIO controller (phandle) and offset,
+  its Kernel Id is the base of the gpiochip of that controller plus the
+  offset:
+
+    <gpio dir>/gpiochipN/base                        first Kernel Id
+    <gpio dir>/gpiochipN/device/of_node/phandle      controller
+
+  The IIO device directory defaults to DHT_IIO_DIR, the GPIO chip
+  directory to DHT_GPIO_DIR, both can be changed with the environment
+  variable of the same name (e.g. to point them to a fake sysfs tree for
+  testing).
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdint.h>
+
+#include "dht.h"
+
+#define IIO_DRIVER_NAME "dht11"
+
+/* Imported variables */
+extern int16_t temperature;
+extern int16_t humidity;
+extern uint8_t raw_frame[DHT_FRAME_SIZE];
+extern uint8_t data_pin;
+extern DHT_MODEL_t sensor_model;
+extern DHT_ERROR_t error_code;
+extern uint32_t last_read_time;
+
+/* Imported functions */
+extern uint32_t dhtMicros(void);
+extern void dhtStatsCapture(uint32_t capture_time, uint32_t samples);
+
+static int temp_fd = -1;
+static int humidity_fd = -1;
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    read_file()
+ *
+ * Description: Reads the content of a (small) file
+ *
+ * Parameters:  filename (in) : file name
+ *              buf (out)     : file content
+ *              len (in)      : size of buf
+ *
+ * Return:      number of bytes read, -1 on error
+ *
+ ********************************************************************/
+static int read_file(const char *filename, char *buf, int len)
+{
+  int fd, n;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  n = read(fd, buf, len);
+  close(fd);
+  return n;
+}
+
+/*********************************************************************
+ * Function:    be32()
+ *
+ * Description: Converts a device tree cell (big endian)
+ *
+ ********************************************************************/
+static uint32_t be32(const uint8_t *b)
+{
+  return (uint32_t)b[0]<<24 | b[1]<<16 | b[2]<<8 | b[3];
+}
+
+/*********************************************************************
+ * Function:    chip_base()
+ *
+ * Description: Gets the Kernel Id of the first pin of the GPIO chip of
+ *              a GPIO controller
+ *
+ * Parameters:  phandle (in) : device tree phandle of the controller
+ *              offset (in)  : pin offset, must be on the chip
+ *
+ * Return:      Kernel Id of the first pin, -1 if not found
+ *
+ ********************************************************************/
+static int chip_base(uint32_t phandle, uint32_t offset)
+{
+  const char *gpio_dir = getenv("DHT_GPIO_DIR");
+  char b[600];
+  uint8_t cell[4];
+  struct dirent *entry;
+  DIR *d;
+  int n, base = -1;
+
+  if (gpio_dir == NULL)
+    gpio_dir = DHT_GPIO_DIR;
+
+  d = opendir(gpio_dir);
+  if (d == NULL)
+    return -1;
+  while (base < 0 && (entry = readdir(d)) != NULL) {
+    if (strncmp(entry->d_name, "gpiochip", 8) != 0)
+      continue;
+    snprintf(b, sizeof(b), "%s/%s/device/of_node/phandle", gpio_dir, entry->d_name);
+    if (read_file(b, (char*)cell, sizeof(cell)) != 4 || be32(cell) != phandle)
+      continue;
+    snprintf(b, sizeof(b), "%s/%s/ngpio", gpio_dir, entry->d_name);
+    n = read_file(b, b, sizeof(b)-1);
+    if (n > 0) {
+      b[n] = 0;
+      if (offset >= strtoul(b, NULL, 10))
+        continue;
+    }
+    snprintf(b, sizeof(b), "%s/%s/base", gpio_dir, entry->d_name);
+    n = read_file(b, b, sizeof(b)-1);
+    if (n > 0) {
+      b[n] = 0;
+      base = atoi(b);
+    }
+  }
+  closedir(d);
+  return base;
+}
+
+/*********************************************************************
+ * Function:    device_pin()
+ *
+ * Description: Gets the data pin of an IIO dht11 device from its
+ *              device tree node (gpios = <&phandle offset flags>)
+ *
+ * Parameters:  dir (in) : device directory
+ *
+ * Return:      Kernel Id of the data pin, -1 if not a dht11 device or
+ *              the GPIO chip of the pin is not found
+ *
+ ********************************************************************/
+static int device_pin(const char *dir)
+{
+  char b[600];
+  uint8_t cells[12];
+  int n, base;
+
+  snprintf(b, sizeof(b), "%s/name", dir);
+  n = read_file(b, b, sizeof(b)-1);
+  if (n <= 0)
+    return -1;
+  b[n] = 0;
+  if (strncmp(b, IIO_DRIVER_NAME, strlen(IIO_DRIVER_NAME)) != 0 ||
+      (b[strlen(IIO_DRIVER_NAME)] != '\n' && b[strlen(IIO_DRIVER_NAME)] != 0))
+    return -1;
+
+  // device tree properties are big endian 32 bit cells
+  snprintf(b, sizeof(b), "%s/of_node/gpios", dir);
+  if (read_file(b, (char*)cells, sizeof(cells)) < 8)
+    return -1;
+  base = chip_base(be32(&cells[0]), be32(&cells[4]));
+  if (base < 0)
+    return -1;
+  return base + be32(&cells[4]);
+}
+
+/*********************************************************************
+ * Function:    read_value()
+ *
+ * Description: Reads a channel value of the IIO device. Each read at
+ *              offset 0 of the sysfs file makes the driver return a
+ *              current reading (it does a new sensor transaction if
+ *              the last one is older than 2 seconds).
+ *
+ * Parameters:  fd (in)     : channel file
+ *              value (out) : value in 1/1000
+ *
+ * Return:      ERROR_NONE, ERROR_TIMEOUT or ERROR_CHECKSUM as
+ *              reported by the driver, ERROR_OTHER otherwise
+ *
+ ********************************************************************/
+static DHT_ERROR_t read_value(int fd, int32_t *value)
+{
+  char b[16];
+  int n;
+
+  n = pread(fd, b, sizeof(b)-1, 0);
+  if (n < 0) {
+    // the driver reports missing edges with ETIMEDOUT and bad
+    // checksums or a wrong number of edges with EIO
+    if (errno == ETIMEDOUT)
+      return ERROR_TIMEOUT;
+    if (errno == EIO)
+      return ERROR_CHECKSUM;
+    fprintf(stderr, "Unable to read IIO channel: %s\n", strerror(errno));
+    return ERROR_OTHER;
+  }
+  b[n] = 0;
+  *value = strtol(b, NULL, 10);
+  return ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    make_frame()
+ *
+ * Description: Builds the sensor data frame for the reading, as the
+ *              driver does not provide it
+ *
+ * Parameters:  frame (out) : sensor data frame
+ *
+ ********************************************************************/
+static void make_frame(uint8_t *frame)
+{
+  uint16_t t = (temperature < 0 ? -temperature : temperature);
+
+  if (sensor_model == DHT11) {
+    frame[0] = humidity / 10;
+    frame[1] = humidity % 10;
+    frame[2] = t / 10;
+    frame[3] = t % 10;
+  }
+  else {
+    frame[0] = humidity >> 8;
+    frame[1] = humidity & 0xFF;
+    frame[2] = (t >> 8) | (temperature < 0 ? 0x80 : 0);
+    frame[3] = t & 0xFF;
+  }
+  frame[4] = frame[0] + frame[1] + frame[2] + frame[3];
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function: dhtSetup_iio()
+ *
+ * Description: Looks for an IIO dht11 device using the given data pin
+ *              and opens its channel files
+ *
+ * Parameters: pin - GPIO Kernel Id of used IO pin
+ *             model - sensors model
+ *
+ * Return:     1 if the sensor is handled by the kernel driver,
+ *             0 otherwise
+ *
+ ********************************************************************/
+int dhtSetup_iio(uint8_t pin, DHT_MODEL_t model)
+{
+  const char *iio_dir = getenv("DHT_IIO_DIR");
+  char dir[512];
+  char b[600];
+  struct dirent *entry;
+  DIR *d;
+  int found = 0;
+
+  if (iio_dir == NULL)
+    iio_dir = DHT_IIO_DIR;
+
+  d = opendir(iio_dir);
+  if (d == NULL)
+    return 0;
+  while (!found && (entry = readdir(d)) != NULL) {
+    if (strncmp(entry->d_name, "iio:device", 10) != 0)
+      continue;
+    snprintf(dir, sizeof(dir), "%s/%s", iio_dir, entry->d_name);
+    found = (device_pin(dir) == pin);
+  }
+  closedir(d);
+  if (!found)
+    return 0;
+
+  // store globals
+  data_pin = pin;
+  resetTimer();
+
+  // Open channel files for fast reading when requested
+  snprintf(b, sizeof(b), "%s/in_temp_input", dir);
+  temp_fd = open(b, O_RDONLY);
+  if (temp_fd < 0) {
+    fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+    error_code = ERROR_OTHER;
+    return 1;
+  }
+  snprintf(b, sizeof(b), "%s/in_humidityrelative_input", dir);
+  humidity_fd = open(b, O_RDONLY);
+  if (humidity_fd < 0) {
+    fprintf(stderr, "Open %s: %s\n", b, strerror(errno));
+    error_code = ERROR_OTHER;
+    return 1;
+  }
+
+  // the driver detects the model itself, the frame is built in the
+  // DHT22 format unless a DHT11 is requested
+  sensor_model = (model == DHT11 ? DHT11 : DHT22);
+
+  error_code = ERROR_NONE;
+  return 1;
+}
+
+/*********************************************************************
+ * Function:    dhtCleanup_iio()
+ *
+ * Description: Cleanup of globally used resources
+ *
+ * Parameters:  none
+ *
+ ********************************************************************/
+void dhtCleanup_iio(void)
+{
+  if (temp_fd >= 0) close(temp_fd);
+  if (humidity_fd >= 0) close(humidity_fd);
+  temp_fd = -1;
+  humidity_fd = -1;
+  error_code = ERROR_NONE;
+}
+
+/*********************************************************************
+ * Function:    readSensor_iio()
+ *
+ * Description: reads the current sensor data from the kernel driver
+ *
+ * Parameters:  none
+ *
+ * Return:      sets the following global variables:
+ *              - error_code
+ *              - temperature
+ *              - humidity
+ ********************************************************************/
+void readSensor_iio()
+{
+  uint32_t capture_time;
+  int32_t t = 0, h = 0;
+
+  temperature = 0;
+  humidity = 0;
+
+  // Both values are taken from the same sensor transaction,
+  // the second read returns the reading cached by the driver
+  capture_time = dhtMicros();
+  error_code = read_value(temp_fd, &t);
+  if (error_code == ERROR_NONE)
+    error_code = read_value(humidity_fd, &h);
+  dhtStatsCapture(dhtMicros() - capture_time, 0);
+
+  if (error_code != ERROR_NONE)
+    return;
+
+  // Convert to 1/10 and store in global variables
+  temperature = t / 100;
+  humidity = h / 100;
+  make_frame(raw_frame);
+}
@@ -0,0 +1,228 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the threshold notifications. A consumer
+  registers a threshold with hysteresis on the temperature or humidity
+  of a sensor and gets an eventfd for it. Each reading of the sensor
+  evaluates its thresholds, and the eventfd is signalled only when the
+  value crosses one, and once for the first reading to report the
+  initial state (a value between low and high is BELOW initially).
+  The consumer can wait on the eventfd with poll() or select() in
+  another thread, instead of polling the readings. The threshold table
+  is protected by a mutex, thresholds can be added and removed in any
+  thread.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+   18-10-2026: Thresholds keyed by transport and pin, thread safe
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "dht.h"
+
+/* Imported variables */
+extern int16_t temperature;
+extern int16_t humidity;
+extern uint8_t data_pin;
+extern DHT_TRANSPORT_t transport;
+extern DHT_ERROR_t error_code;
+
+/* Registered thresholds */
+static struct {
+   int fd;                   // eventfd, -1 if slot is unused
+   DHT_THRESHOLD_t threshold;
+   // state and value at the latest crossing: state<<16 | (uint16_t)value
+   uint32_t state;
+} thresholds[DHT_MAX_THRESHOLDS] = {
+   [0 ... DHT_MAX_THRESHOLDS-1] = { .fd = -1 }
+};
+static pthread_mutex_t thresholds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    find_threshold()
+ *
+ * Description: Finds the slot of a threshold by its eventfd (called
+ *              with the table locked)
+ *
+ * Parameters:  fd - eventfd of the threshold
+ *
+ * Return:      index of the slot, -1 if not found
+ *
+ ********************************************************************/
+static int find_threshold(int fd)
+{
+  int i;
+
+  for (i=0; i<DHT_MAX_THRESHOLDS; i++)
+    if (fd >= 0 && thresholds[i].fd == fd)
+      return i;
+  return -1;
+}
+
+
+/*********************************************************************
+ * LIBRARY INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtNotifyUpdate()
+ *
+ * Description: Evaluates the thresholds of the current sensor after
+ *              a reading and signals the crossed ones
+ *
+ ********************************************************************/
+void dhtNotifyUpdate(void)
+{
+  const DHT_THRESHOLD_t *t;
+  DHT_THRESHOLD_STATE_t old_state, new_state;
+  uint64_t one = 1;
+  int16_t value;
+  int i;
+
+  if (error_code != ERROR_NONE)
+    return;
+
+  pthread_mutex_lock(&thresholds_lock);
+  for (i=0; i<DHT_MAX_THRESHOLDS; i++) {
+    t = &thresholds[i].threshold;
+    if (thresholds[i].fd < 0 || t->transport != transport || t->pin != data_pin)
+      continue;
+
+    value = (t->value == VALUE_HUMIDITY ? humidity : temperature);
+    old_state = thresholds[i].state >> 16;
+    new_state = old_state;
+    if (value >= t->high)
+      new_state = THRESHOLD_ABOVE;
+    else if (value <= t->low || old_state == THRESHOLD_UNKNOWN)
+      new_state = THRESHOLD_BELOW;
+
+    if (new_state != old_state) {
+      thresholds[i].state = (uint32_t)new_state<<16 | (uint16_t)value;
+      if (write(thresholds[i].fd, &one, sizeof(one)) < 0)
+        fprintf(stderr, "Unable to signal threshold: %s\n", strerror(errno));
+    }
+  }
+  pthread_mutex_unlock(&thresholds_lock);
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtAddThreshold()
+ *
+ * Description: Registers a threshold. The value is ABOVE the threshold
+ *              when it reaches t->high and goes BELOW again only when
+ *              it drops to t->low (hysteresis).
+ *
+ * Parameters:  t - threshold
+ *
+ * Return:      eventfd (non blocking) which is signalled on crossing
+ *              the threshold, -1 on error
+ *
+ ********************************************************************/
+int dhtAddThreshold(const DHT_THRESHOLD_t *t)
+{
+  int i, fd;
+
+  if (t->low > t->high) {
+    fprintf(stderr, "Threshold low value (%d) above high value (%d)\n",
+            t->low, t->high);
+    return -1;
+  }
+
+  fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to create eventfd: %s\n", strerror(errno));
+    return -1;
+  }
+
+  pthread_mutex_lock(&thresholds_lock);
+  for (i=0; i<DHT_MAX_THRESHOLDS && thresholds[i].fd >= 0; i++);
+  if (i < DHT_MAX_THRESHOLDS) {
+    thresholds[i].threshold = *t;
+    thresholds[i].state = (uint32_t)THRESHOLD_UNKNOWN<<16;
+    thresholds[i].fd = fd;
+  }
+  pthread_mutex_unlock(&thresholds_lock);
+
+  if (i == DHT_MAX_THRESHOLDS) {
+    fprintf(stderr, "Too many thresholds\n");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*********************************************************************
+ * Function:    dhtRemoveThreshold()
+ *
+ * Description: Removes a threshold and closes its eventfd
+ *
+ * Parameters:  fd - eventfd of the threshold
+ *
+ ********************************************************************/
+void dhtRemoveThreshold(int fd)
+{
+  int i;
+
+  pthread_mutex_lock(&thresholds_lock);
+  i = find_threshold(fd);
+  if (i >= 0)
+    thresholds[i].fd = -1;
+  pthread_mutex_unlock(&thresholds_lock);
+
+  if (i >= 0)
+    close(fd);
+}
+
+/*********************************************************************
+ * Function:    getThresholdState()
+ *
+ * Description: get the state of a threshold. Reading the eventfd
+ *              before calling this function acknowledges the event.
+ *
+ * Parameters:  fd (in)     - eventfd of the threshold
+ *              value (out) - value at the latest crossing in 1/10
+ *                            (may be NULL)
+ *
+ * Return:      state of the threshold
+ *
+ ********************************************************************/
+DHT_THRESHOLD_STATE_t getThresholdState(int fd, int16_t *value)
+{
+  uint32_t state = (uint32_t)THRESHOLD_UNKNOWN<<16;
+  int i;
+
+  pthread_mutex_lock(&thresholds_lock);
+  i = find_threshold(fd);
+  if (i >= 0)
+    state = thresholds[i].state;
+  pthread_mutex_unlock(&thresholds_lock);
+
+  if (i < 0)
+    return THRESHOLD_UNKNOWN;
+  if (value)
+    *value = (int16_t)(state & 0xFFFF);
+  return state >> 16;
+}
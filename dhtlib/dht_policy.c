@@ -0,0 +1,284 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the retry and recovery policy engine.
+  A sensor reading is repeated according to the type of error:
+  - CHECKSUM errors are retried as soon as the sensor duty cycle allows
+  - TIMEOUT errors are retried with exponential backoff
+  After a configurable number of consecutive failures the sensor is
+  reset via its power pin. A sensor which does not recover from
+  repeated resets is declared dead (only with a power pin).
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+   18-10-2026: Report retries and resets to the read statistics
+   18-10-2026: Sensors without power pin are never declared dead
+   18-10-2026: Duty cycle of the sensor model (dhtDutyCycle())
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dht.h"
+
+/* Imported variables */
+extern uint8_t data_pin;
+extern DHT_ERROR_t error_code;
+extern uint32_t last_read_time;
+
+/* Imported functions */
+extern uint32_t dhtMillis(void);
+extern uint32_t dhtDutyCycle(void);
+extern int dhtSensorSlot(void);
+extern void dhtStatsRetry(uint8_t retries, uint8_t resets);
+
+/* Default policy */
+#define DEFAULT_POLICY {        \
+   .max_retries     = 3,        \
+   .timeout_backoff = 2000,     \
+   .max_backoff     = 16000,    \
+   .reset_threshold = 5,        \
+   .dead_threshold  = 3,        \
+   .power_pin       = 0         \
+}
+
+static DHT_POLICY_t policy = DEFAULT_POLICY;
+
+/* Health information of all known sensors (see dhtSensorSlot()) */
+static struct {
+   uint8_t consecutive_timeouts;
+   DHT_HEALTH_INFO_t info;
+} sensors[DHT_MAX_SENSORS];
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    wait_until()
+ *
+ * Description: Waits until at least the given number of milliseconds
+ *              have passed since the end of the last sensor reading
+ *
+ * Parameters:  delay - delay in ms
+ *
+ ********************************************************************/
+static void wait_until(uint32_t delay)
+{
+  uint32_t elapsed;
+
+  if (last_read_time == 0)
+    return;
+
+  elapsed = dhtMillis() - last_read_time;
+  if (elapsed < delay)
+    usleep((delay - elapsed)*1000);
+}
+
+/*********************************************************************
+ * Function:    reset_sensor()
+ *
+ * Description: Power cycles the sensor if a power pin is configured
+ *              and updates the health information accordingly. Only
+ *              a sensor which is actually reset can be declared dead.
+ *
+ * Parameters:  s - index of the sensors health tracking slot
+ *
+ ********************************************************************/
+static void reset_sensor(int s)
+{
+  DHT_HEALTH_INFO_t *info = &sensors[s].info;
+
+  sensors[s].consecutive_timeouts = 0;
+  if (policy.power_pin == 0)
+    return;
+
+  dhtReset(policy.power_pin);
+  info->resets++;
+
+  // the sensor needs a full duty cycle after power up
+  last_read_time = dhtMillis();
+
+  info->failed_resets++;
+  if (policy.dead_threshold && info->failed_resets >= policy.dead_threshold) {
+    fprintf(stderr, "Sensor on pin %d did not recover after %d resets\n",
+            data_pin, info->failed_resets);
+    info->health = HEALTH_DEAD;
+  }
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtSetPolicy()
+ *
+ * Description: Set the retry and recovery policy used by
+ *              readSensorRetry()
+ *
+ * Parameters:  p - pointer to policy, NULL restores the default
+ *
+ ********************************************************************/
+void dhtSetPolicy(const DHT_POLICY_t *p)
+{
+  static const DHT_POLICY_t default_policy = DEFAULT_POLICY;
+
+  policy = (p ? *p : default_policy);
+}
+
+/*********************************************************************
+ * Function:    readSensorRetry()
+ *
+ * Description: reads the current sensor data and repeats the reading
+ *              according to the configured policy until it succeeds
+ *              or the retries are exhausted. A sensor which has been
+ *              declared dead is not accessed at all.
+ *
+ * Parameters:  none
+ *
+ * Return:      sets the same global variables as readSensor()
+ ********************************************************************/
+void readSensorRetry()
+{
+  int s = dhtSensorSlot();
+  DHT_HEALTH_INFO_t *info = &sensors[s].info;
+  uint32_t duty_cycle = dhtDutyCycle();
+  uint32_t backoff;
+  uint8_t retries = 0;
+  uint8_t resets = 0;
+
+  if (info->health == HEALTH_DEAD) {
+    error_code = ERROR_OTHER;
+    return;
+  }
+
+  while (1) {
+    wait_until(duty_cycle);
+    readSensor();
+    info->reads++;
+
+    if (error_code == ERROR_NONE) {
+      info->consecutive_failures = 0;
+      info->failed_resets = 0;
+      info->health = HEALTH_OK;
+      sensors[s].consecutive_timeouts = 0;
+      break;
+    }
+
+    info->failures++;
+    info->consecutive_failures++;
+    info->health = HEALTH_DEGRADED;
+    if (error_code == ERROR_TIMEOUT) {
+      info->timeouts++;
+      if (sensors[s].consecutive_timeouts < 255)
+        sensors[s].consecutive_timeouts++;
+    }
+    else if (error_code == ERROR_CHECKSUM) {
+      info->checksums++;
+    }
+
+    if (policy.reset_threshold &&
+        (info->consecutive_failures % policy.reset_threshold) == 0) {
+      // keep the error of the failed reading, not the one of the reset
+      DHT_ERROR_t read_error = error_code;
+      reset_sensor(s);
+      error_code = read_error;
+      if (policy.power_pin) resets++;
+      if (info->health == HEALTH_DEAD)
+        break;
+    }
+
+    if (retries == policy.max_retries)
+      break;
+    retries++;
+
+    // A timeout usually means the sensor is busy or disconnected,
+    // so give it more and more time to settle
+    if (sensors[s].consecutive_timeouts) {
+      if (sensors[s].consecutive_timeouts > 16)
+        backoff = policy.max_backoff;
+      else
+        backoff = (uint32_t)policy.timeout_backoff << (sensors[s].consecutive_timeouts-1);
+      if (backoff > policy.max_backoff)
+        backoff = policy.max_backoff;
+      if (backoff > duty_cycle)
+        wait_until(backoff);
+    }
+  }
+
+  dhtStatsRetry(retries, resets);
+}
+
+/*********************************************************************
+ * Function:    dhtHealthInfo()
+ *
+ * Description: get health information of a sensor (library internal)
+ *
+ * Parameters:  slot - sensor slot as returned by dhtSensorSlot()
+ *
+ * Return:      pointer to health information
+ *
+ ********************************************************************/
+const DHT_HEALTH_INFO_t* dhtHealthInfo(int slot)
+{
+  return &sensors[slot].info;
+}
+
+/*********************************************************************
+ * Function:    getHealth()
+ *
+ * Description: get health state of the current sensor
+ *
+ * Parameters:  none
+ *
+ * Return:      health state
+ *
+ ********************************************************************/
+DHT_HEALTH_t getHealth()
+{
+  return sensors[dhtSensorSlot()].info.health;
+}
+
+/*********************************************************************
+ * Function:    getHealthInfo()
+ *
+ * Description: get health information of the current sensor
+ *
+ * Parameters:  none
+ *
+ * Return:      pointer to health information
+ *
+ ********************************************************************/
+const DHT_HEALTH_INFO_t* getHealthInfo()
+{
+  return &sensors[dhtSensorSlot()].info;
+}
+
+/*********************************************************************
+ * Function:    dhtClearHealth()
+ *
+ * Description: clear health information of the current sensor
+ *              (e.g. to bring a dead sensor back into service after
+ *              maintenance)
+ *
+ * Parameters:  none
+ *
+ ********************************************************************/
+void dhtClearHealth()
+{
+  int s = dhtSensorSlot();
+
+  memset(&sensors[s].info, 0, sizeof(sensors[s].info));
+  sensors[s].consecutive_timeouts = 0;
+}
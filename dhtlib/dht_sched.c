@@ -0,0 +1,263 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the adaptive read scheduler. For each
+  sensor it keeps a short term estimate of how fast the temperature
+  and humidity are changing and of the read success rate, and derives
+  the interval to the next reading from them:
+  - the interval is chosen so that the estimated change until the next
+    reading is about one configured step of temperature or humidity
+  - a sudden change brings the interval down at once, a steady reading
+    lets it grow by at most a factor 2 per reading
+  - a failing sensor is read less often, down to half its max rate
+  The interval always stays between the sensor duty cycle and the
+  configured maximum.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+   18-10-2026: Duty cycle of the sensor model (dhtDutyCycle())
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dht.h"
+
+// Success rate estimate is in 1/SUCCESS_ONE
+#define SUCCESS_ONE 256
+
+/* Imported variables */
+extern int16_t temperature;
+extern int16_t humidity;
+extern DHT_ERROR_t error_code;
+extern uint32_t last_read_time;
+
+/* Imported functions */
+extern uint32_t dhtMillis(void);
+extern uint32_t dhtDutyCycle(void);
+extern int dhtSensorSlot(void);
+
+/* Default schedule: fixed interval of one duty cycle */
+#define DEFAULT_SCHEDULE {      \
+   .max_interval  = 0,          \
+   .temp_step     = 2,          \
+   .humidity_step = 10          \
+}
+
+static DHT_SCHEDULE_t schedule = DEFAULT_SCHEDULE;
+
+/* Scheduling state of all known sensors (see dhtSensorSlot()) */
+static struct {
+   uint8_t  valid;          // previous reading available
+   uint8_t  failed;         // latest reading failed
+   int16_t  temperature;    // previous reading
+   int16_t  humidity;
+   uint32_t time;           // time of previous valid reading (ms)
+   uint32_t last;           // time of latest reading (ms)
+   uint32_t temp_rate;      // rate of change (1/1000 tenths per second)
+   uint32_t humidity_rate;
+   uint16_t success;        // success rate (1/SUCCESS_ONE)
+   uint32_t interval;       // read interval (ms), 0 if not yet set
+} sensors[DHT_MAX_SENSORS];
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    update_rate()
+ *
+ * Description: Updates a rate of change estimate with a new pair of
+ *              readings. Rising rates are taken over at once, falling
+ *              rates decay slowly.
+ *
+ * Parameters:  rate (in/out) : rate estimate (1/1000 tenths per s)
+ *              delta (in)    : change of the reading (tenths)
+ *              elapsed (in)  : time between the readings (ms)
+ *
+ ********************************************************************/
+static void update_rate(uint32_t *rate, int32_t delta, uint32_t elapsed)
+{
+  uint64_t r = (uint64_t)abs(delta) * 1000000 / elapsed;
+
+  if (r > 0xFFFFFFFF)
+    r = 0xFFFFFFFF;
+  if (r > *rate)
+    *rate = r;
+  else
+    *rate = (*rate * 3 + r) / 4;
+}
+
+/*********************************************************************
+ * Function:    step_interval()
+ *
+ * Description: Time in which the reading is expected to change by
+ *              the given step
+ *
+ * Parameters:  step (in) : step (tenths)
+ *              rate (in) : rate of change (1/1000 tenths per s)
+ *
+ * Return:      interval in ms, 0xFFFFFFFF if the reading is steady
+ *
+ ********************************************************************/
+static uint32_t step_interval(uint16_t step, uint32_t rate)
+{
+  uint64_t t;
+
+  if (rate == 0)
+    return 0xFFFFFFFF;
+  t = (uint64_t)step * 1000000 / rate;
+  return (t > 0xFFFFFFFF ? 0xFFFFFFFF : t);
+}
+
+/*********************************************************************
+ * Function:    min_interval()
+ *
+ * Description: Shortest read interval for the current sensor: the
+ *              duty cycle, stretched up to twice of it as the success
+ *              rate drops
+ *
+ * Parameters:  s - index of the sensors slot
+ *
+ * Return:      interval in ms
+ *
+ ********************************************************************/
+static uint32_t min_interval(int s)
+{
+  uint32_t duty_cycle = dhtDutyCycle();
+
+  return duty_cycle * 2 * SUCCESS_ONE / (SUCCESS_ONE + sensors[s].success);
+}
+
+
+/*********************************************************************
+ * LIBRARY INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtSchedUpdate()
+ *
+ * Description: Updates the read interval of the current sensor after
+ *              a reading
+ *
+ ********************************************************************/
+void dhtSchedUpdate(void)
+{
+  int s = dhtSensorSlot();
+  uint32_t min, max, target, elapsed;
+
+  if (sensors[s].interval == 0) {
+    sensors[s].success = SUCCESS_ONE;
+    sensors[s].interval = min_interval(s);
+  }
+
+  sensors[s].last = last_read_time;
+  sensors[s].failed = (error_code != ERROR_NONE);
+  if (sensors[s].failed) {
+    sensors[s].success -= sensors[s].success / 4;
+    return;
+  }
+  sensors[s].success += (SUCCESS_ONE - sensors[s].success + 3) / 4;
+
+  if (sensors[s].valid) {
+    elapsed = last_read_time - sensors[s].time;
+    if (elapsed == 0)
+      elapsed = 1;
+    update_rate(&sensors[s].temp_rate, temperature - sensors[s].temperature, elapsed);
+    update_rate(&sensors[s].humidity_rate, humidity - sensors[s].humidity, elapsed);
+  }
+  sensors[s].valid = 1;
+  sensors[s].temperature = temperature;
+  sensors[s].humidity = humidity;
+  sensors[s].time = last_read_time;
+
+  // Aim at one step of change per interval
+  target = step_interval(schedule.temp_step, sensors[s].temp_rate);
+  if (step_interval(schedule.humidity_step, sensors[s].humidity_rate) < target)
+    target = step_interval(schedule.humidity_step, sensors[s].humidity_rate);
+
+  // grow slowly, shrink at once
+  if (target / 2 > sensors[s].interval)
+    target = sensors[s].interval * 2;
+
+  min = min_interval(s);
+  max = (schedule.max_interval > min ? schedule.max_interval : min);
+  if (target < min)
+    target = min;
+  if (target > max)
+    target = max;
+  sensors[s].interval = target;
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtSetSchedule()
+ *
+ * Description: Set the parameters of the adaptive read scheduler
+ *
+ * Parameters:  sched - pointer to schedule, NULL restores the default
+ *                      (fixed interval of one sensor duty cycle)
+ *
+ ********************************************************************/
+void dhtSetSchedule(const DHT_SCHEDULE_t *sched)
+{
+  static const DHT_SCHEDULE_t default_schedule = DEFAULT_SCHEDULE;
+
+  schedule = (sched ? *sched : default_schedule);
+}
+
+/*********************************************************************
+ * Function:    getReadInterval()
+ *
+ * Description: get the current read interval of the current sensor
+ *
+ * Parameters:  none
+ *
+ * Return:      interval in ms
+ *
+ ********************************************************************/
+uint32_t getReadInterval()
+{
+  int s = dhtSensorSlot();
+
+  if (sensors[s].interval == 0)
+    return dhtDutyCycle();
+  return sensors[s].interval;
+}
+
+/*********************************************************************
+ * Function:    dhtNextRead()
+ *
+ * Description: get the time until the next reading of the current
+ *              sensor is due. After a failed reading the sensor is
+ *              due again after the shortest interval.
+ *
+ * Parameters:  none
+ *
+ * Return:      time in ms, 0 if the reading is due now
+ *
+ ********************************************************************/
+uint32_t dhtNextRead()
+{
+  int s = dhtSensorSlot();
+  uint32_t interval, elapsed;
+
+  if (sensors[s].interval == 0)
+    return 0;
+
+  interval = (sensors[s].failed ? min_interval(s) : sensors[s].interval);
+  elapsed = dhtMillis() - sensors[s].last;
+  return (elapsed < interval ? interval - elapsed : 0);
+}
@@ -19,6 +19,11 @@
   Changelog:
    11-11-2014: Initial version (porting and integrating Daniels code)
    24-11-2014: Added support for DHT11 sensor
+   18-10-2026: Added collection of read statistics
+   18-10-2026: Replaced debug printouts by trace records
+   18-10-2026: Pass raw line samples to capture handler
+   18-10-2026: Use integer arithmetic only
+   18-10-2026: Keep the validated data frame
 
 ************************************************************************/
 
@@ -56,13 +61,11 @@
 #include <linux/spi/spidev.h>
 
 #include "dht.h"
-
-// Debug mode: set to 1 to print debug information
-#define DEBUG 0
+#include "dht_trace.h"
 
 #define RSP_DATA_SIZE 5
-#define MAX_PULSE_LENGTH_ZERO 40 // 26-28us
-#define MAX_PULSE_LENGTH_ONE  80 // 70us
+#define MAX_PULSE_LENGTH_ZERO DHT_SPI_MAX_PULSE_ZERO
+#define MAX_PULSE_LENGTH_ONE  DHT_SPI_MAX_PULSE_ONE
 #define MIN_BIT_LENGTH 5
 #define MAX_BIT_LENGTH MAX_PULSE_LENGTH_ONE
 
@@ -70,11 +73,18 @@
 #define SPIDEV2 "/dev/spidev32766.0"
 
 /* Imported variables */
-extern float temperature;
-extern float humidity;
+extern int16_t temperature;
+extern int16_t humidity;
+extern uint8_t raw_frame[DHT_FRAME_SIZE];
 extern DHT_MODEL_t sensor_model;
 extern DHT_ERROR_t error_code;
 extern uint32_t last_read_time;
+extern DHT_CAPTURE_HANDLER_t capture_handler;
+
+/* Imported functions */
+extern uint32_t dhtMicros(void);
+extern void dhtStatsCapture(uint32_t capture_time, uint32_t samples);
+extern void dhtStatsPulse(uint16_t width, uint16_t threshold);
 
 /* SPI protocol settings */
 static const char *spidev1 = SPIDEV1;
@@ -87,6 +97,13 @@ static uint16_t delay = 0;
 
 static int fd=0;
 
+#if DHT_TRACE
+static int8_t trace_edge;
+#endif
+
+/* Time of a bit in the data buffer in usec (used for tracing) */
+#define BIT_TIME(bit_idx) ((uint32_t)(((bit_idx) * 1000) / (speed / 1000)))
+
 
 /*********************************************************************
  * INTERNAL FUNCTIONS
@@ -170,10 +187,11 @@ static int get_pulse_length(uint8_t* data_buf, int* bit_idx, int max_bit)
       if(get_bit(data_buf, i) != last_bit)
       { 
          bit_delta = i-start_bit_idx;
+         TRACE(TRACE_EDGE, BIT_TIME(i), trace_edge++, !last_bit, bit_delta);
          
          /* Return current bit index and pulse length in usec */
          *bit_idx = i;
-         return ((int)((1000000.0 * bit_delta) / speed));
+         return ((bit_delta * 1000) / (int)(speed / 1000));
       }
    }
    
@@ -201,6 +219,11 @@ static int decode_data(uint8_t* data_in, uint8_t* data_out, int max_bit)
    int bit_num=0;
    uint32_t pulse_len;
 
+#if DHT_TRACE
+   /* First edge is the end of the host request, then 3 edges of the
+    * sensor init response follow (same numbering as for GPIO) */
+   trace_edge = -4;
+#endif
    
    /* Skip host request sequence (low part) */
    pulse_len = get_pulse_length(data_in, &bit_num, max_bit);
@@ -231,7 +254,11 @@ static int decode_data(uint8_t* data_in, uint8_t* data_out, int max_bit)
          
          /* Check for invalid pulses */
          if ((pulse_len < MIN_BIT_LENGTH) || (pulse_len > MAX_BIT_LENGTH))
+         {
+            TRACE(TRACE_TIMEOUT, BIT_TIME(bit_num), trace_edge, get_bit(data_in, bit_num), pulse_len);
             return 1;
+         }
+         dhtStatsPulse(pulse_len, MAX_PULSE_LENGTH_ZERO);
          
          /* Detect bit value according to the pulse length */
          if (pulse_len > MAX_PULSE_LENGTH_ZERO)
@@ -344,20 +371,21 @@ void readSensor_spi(int argc, char *argv[])
    uint8_t checksum=0;
    int i;
    int ret;
-   float start_delay=0;
+   uint32_t capture_time;
+   uint32_t start_delay=0;  /* us */
       
    /* Define sensor specific parameters */
    switch (sensor_model)
    {
       case DHT11:
-         start_delay = 12.0/1000; // 30ms (12ms for Arietta)
+         start_delay = 12000; // 30ms (12ms for Arietta)
       break;
       
       case DHT22:
       case AM2302:
       case RHT03:
          sensor_model = DHT22;
-         start_delay = 0.8/1000;  // 1.5ms (0.8ms for Arietta)
+         start_delay = 800;   // 1.5ms (0.8ms for Arietta)
       break;
       
       case AUTO_DETECT:
@@ -381,9 +409,9 @@ void readSensor_spi(int argc, char *argv[])
     * exceed duration of init sequence + 5ms of data response
     * We create a byte array big enough to contain all data bits 
     */
-   float comm_period = start_delay + 6.0/1000;
-   int num_bits  =  (int)(comm_period * speed);
-   int num_bytes =  num_bits / bits;
+   uint32_t comm_period = start_delay + 6000; /* us */
+   int num_bytes =  (comm_period * (speed / 1000)) / 1000 / bits;
+   int num_bits  =  num_bytes * bits;
    uint8_t *spi_data = (uint8_t *)malloc(num_bytes);
    
    /* 
@@ -391,41 +419,29 @@ void readSensor_spi(int argc, char *argv[])
     *   - start for <start_delay> with 0 (Low)
     *   - then switch to 1 (High) to wait for the response
     */
-   int start_offset = (int)((start_delay * speed) / bits);
+   int start_offset = (start_delay * (speed / 1000)) / 1000 / bits;
    memset(spi_data, 0, start_offset);
    memset(&spi_data[start_offset], 0xff, num_bytes-start_offset);
 
-#if DEBUG   
-   printf("\n");
-   printf("speed: %d Hz\n", speed);
-   printf("start_delay: %f\n", start_delay);
-   printf("comm_period: %f\n", comm_period);
-   printf("num_bits: %d\n", num_bits);
-   printf("num_bytes: %d\n", num_bytes);
-   printf("start_offset: %d (%f s)\n", start_offset, start_offset*bits/(float)speed);
-
-   printf("\nREQUEST");
-   for (i=0; i<num_bytes; i++)
-   {
-      if((i%100)==0) printf("\n%03d ", i);
-      printf("%02X",spi_data[i]);
-   }
-   printf("\n");
-#endif
+   TRACE(TRACE_START, 0, 0, LOW, 0);
+   TRACE(TRACE_RELEASE, BIT_TIME(start_offset*bits), 0, HIGH, 0);
    
    /* Perform the data transfer */
+   capture_time = dhtMicros();
    spi_data_transfer(fd, spi_data, num_bytes);
-        
-#if DEBUG   
-   printf("\nRESPONSE");
-   for (i=0; i<num_bytes; i++)
+   dhtStatsCapture(dhtMicros() - capture_time, num_bits);
+   
+   if (capture_handler)
    {
-      if((i%100)==0) printf("\n%03d ", i);
-      printf("%02X",spi_data[i]);
+      DHT_CAPTURE_t capture = {
+         .rate = speed,
+         .start = start_offset*bits,
+         .num_samples = num_bytes*bits,
+         .data = spi_data
+      };
+      capture_handler(&capture);
    }
-   printf("\n");
-#endif
-   
+        
    /* Decode the sensor response */
    ret = decode_data(spi_data, sensor_data, num_bits);
    free(spi_data);
@@ -442,23 +458,14 @@ void readSensor_spi(int argc, char *argv[])
       checksum += sensor_data[i];
    if (checksum != sensor_data[4])
    {
+      TRACE(TRACE_CHECKSUM, BIT_TIME(num_bits), 0, HIGH, sensor_data[4]);
       error_code = ERROR_CHECKSUM;
       return;
    }
    
    /* Calculate temperature and humidity values from raw data */
-   if ( sensor_model == DHT11 ) 
-   {
-      humidity = (float)sensor_data[0];
-      temperature = (float)sensor_data[2];
-   }
-   else
-   {
-      humidity = ((uint16_t)sensor_data[0]<<8 | sensor_data[1])/10.0;
-      temperature = ((uint16_t)(sensor_data[2] & 0x7f)<<8 | sensor_data[3])/10.0;
-      if((sensor_data[2] & 0x80)== 0x80)
-         temperature = -(temperature);
-   }
+   memcpy(raw_frame, sensor_data, DHT_FRAME_SIZE);
+   dhtFrameToTenths(sensor_data, sensor_model, &temperature, &humidity);
    
    error_code = ERROR_NONE;
 }
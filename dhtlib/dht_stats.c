@@ -0,0 +1,335 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the per read statistics and of the
+  metrics exporter which writes the accumulated statistics of all
+  sensors in the Prometheus text format, to be picked up by the
+  node_exporter textfile collector.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+   18-10-2026: Label I2C sensors by bus
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "dht.h"
+
+#define NO_MARGIN 0xFFFF
+
+/* Imported variables */
+extern DHT_ERROR_t error_code;
+
+/* Imported functions */
+extern uint32_t dhtMicros(void);
+extern int dhtSensorSlot(void);
+extern int dhtSensorPin(int slot);
+extern int dhtSensorTransport(int slot);
+extern const DHT_HEALTH_INFO_t* dhtHealthInfo(int slot);
+
+static DHT_READ_STATS_t read_stats = { .margin = NO_MARGIN };
+static DHT_STATS_t stats[DHT_MAX_SENSORS];
+static uint32_t start_time;
+static uint32_t pulse_sum;
+
+static const char *result_names[] = { "ok", "timeout", "checksum", "other" };
+
+
+/*********************************************************************
+ * INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    sensor_label()
+ *
+ * Description: Assembles the label identifying a sensor in the
+ *              exported metrics
+ *
+ * Parameters:  label (out) : label string
+ *              len (in)    : length of the label buffer
+ *              slot (in)   : sensor slot
+ *
+ ********************************************************************/
+static void sensor_label(char *label, int len, int slot)
+{
+  int pin = dhtSensorPin(slot);
+
+  switch (dhtSensorTransport(slot)) {
+    case TRANSPORT_SPI:
+      snprintf(label, len, "sensor=\"spi\"");
+      break;
+    case TRANSPORT_I2C:
+      snprintf(label, len, "sensor=\"i2c%d\"", pin);
+      break;
+    default:
+      snprintf(label, len, "sensor=\"gpio%d\"", pin);
+      break;
+  }
+}
+
+/*********************************************************************
+ * Function:    write_header()
+ *
+ * Description: Writes the HELP and TYPE lines of a metric
+ *
+ ********************************************************************/
+static void write_header(FILE *f, const char *name, const char *type, const char *help)
+{
+  fprintf(f, "# HELP %s %s\n", name, help);
+  fprintf(f, "# TYPE %s %s\n", name, type);
+}
+
+
+/*********************************************************************
+ * LIBRARY INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtStatsBegin()
+ *
+ * Description: Starts collecting statistics for a new reading
+ *
+ ********************************************************************/
+void dhtStatsBegin(void)
+{
+  memset(&read_stats, 0, sizeof(read_stats));
+  read_stats.margin = NO_MARGIN;
+  pulse_sum = 0;
+  start_time = dhtMicros();
+}
+
+/*********************************************************************
+ * Function:    dhtStatsCapture()
+ *
+ * Description: Records the effort of capturing the sensor response
+ *
+ * Parameters:  capture_time - duration of the capture (us)
+ *              samples      - number of line samples taken
+ *
+ ********************************************************************/
+void dhtStatsCapture(uint32_t capture_time, uint32_t samples)
+{
+  read_stats.capture_time = capture_time;
+  read_stats.samples = samples;
+}
+
+/*********************************************************************
+ * Function:    dhtStatsPulse()
+ *
+ * Description: Records the width of a received data bit pulse
+ *
+ * Parameters:  width     - pulse width (us)
+ *              threshold - max pulse width of a 0 bit (us)
+ *
+ ********************************************************************/
+void dhtStatsPulse(uint16_t width, uint16_t threshold)
+{
+  int bin = (width ? (width-1)/DHT_PULSE_HIST_WIDTH : 0);
+  uint16_t margin = (width > threshold ? width-threshold : threshold-width);
+
+  if (bin >= DHT_PULSE_HIST_BINS)
+    bin = DHT_PULSE_HIST_BINS-1;
+  read_stats.pulse_hist[bin]++;
+  read_stats.bits++;
+  pulse_sum += width;
+  if (margin < read_stats.margin)
+    read_stats.margin = margin;
+}
+
+/*********************************************************************
+ * Function:    dhtStatsEnd()
+ *
+ * Description: Finishes the statistics of the latest reading and
+ *              adds them to the accumulated statistics of the sensor
+ *
+ ********************************************************************/
+void dhtStatsEnd(void)
+{
+  DHT_STATS_t *st = &stats[dhtSensorSlot()];
+  int i;
+
+  read_stats.latency = dhtMicros() - start_time;
+  read_stats.error = error_code;
+
+  if (st->reads == 0)
+    st->min_margin = NO_MARGIN;
+  st->reads++;
+  if (error_code <= ERROR_OTHER)
+    st->errors[error_code]++;
+  st->latency_sum += read_stats.latency;
+  st->capture_time_sum += read_stats.capture_time;
+  st->samples += read_stats.samples;
+  st->pulses += read_stats.bits;
+  st->pulse_sum += pulse_sum;
+  for (i=0; i<DHT_PULSE_HIST_BINS; i++)
+    st->pulse_hist[i] += read_stats.pulse_hist[i];
+  if (read_stats.margin < st->min_margin)
+    st->min_margin = read_stats.margin;
+}
+
+/*********************************************************************
+ * Function:    dhtStatsRetry()
+ *
+ * Description: Records the retries and resets done by
+ *              readSensorRetry() to get the latest reading
+ *
+ * Parameters:  retries - number of retries
+ *              resets  - number of sensor resets
+ *
+ ********************************************************************/
+void dhtStatsRetry(uint8_t retries, uint8_t resets)
+{
+  read_stats.retries = retries;
+  read_stats.resets = resets;
+  stats[dhtSensorSlot()].retries += retries;
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    getReadStats()
+ *
+ * Description: get statistics of the latest readSensor() or
+ *              readSensorRetry()
+ *
+ * Parameters:  none
+ *
+ * Return:      pointer to statistics
+ *
+ ********************************************************************/
+const DHT_READ_STATS_t* getReadStats()
+{
+  return &read_stats;
+}
+
+/*********************************************************************
+ * Function:    getStats()
+ *
+ * Description: get accumulated statistics of the current sensor
+ *
+ * Parameters:  none
+ *
+ * Return:      pointer to statistics
+ *
+ ********************************************************************/
+const DHT_STATS_t* getStats()
+{
+  return &stats[dhtSensorSlot()];
+}
+
+/*********************************************************************
+ * Function:    dhtWriteMetrics()
+ *
+ * Description: Writes the accumulated statistics of all sensors to a
+ *              file in Prometheus text format. The file is replaced
+ *              atomically, so it can be placed directly in the
+ *              directory of the node_exporter textfile collector.
+ *
+ * Parameters:  filename - name of metrics file (should end in .prom)
+ *
+ * Return:      0 on success, -1 on error
+ *
+ ********************************************************************/
+int dhtWriteMetrics(const char *filename)
+{
+  char tmpname[256];
+  char label[32];
+  FILE *f;
+  int s, i;
+  uint32_t count;
+
+  snprintf(tmpname, sizeof(tmpname), "%s.%d", filename, getpid());
+  f = fopen(tmpname, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Open %s: %s\n", tmpname, strerror(errno));
+    return -1;
+  }
+
+  write_header(f, "dht_reads_total", "counter", "Sensor read attempts by result.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    for (i=0; i<=ERROR_OTHER; i++)
+      fprintf(f, "dht_reads_total{%s,result=\"%s\"} %u\n",
+              label, result_names[i], stats[s].errors[i]);
+  }
+
+  write_header(f, "dht_read_duration_seconds", "summary", "Duration of sensor reads.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_read_duration_seconds_sum{%s} %.6f\n", label, stats[s].latency_sum/1e6);
+    fprintf(f, "dht_read_duration_seconds_count{%s} %u\n", label, stats[s].reads);
+  }
+
+  write_header(f, "dht_capture_duration_seconds", "summary", "Time spent capturing the sensor response.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_capture_duration_seconds_sum{%s} %.6f\n", label, stats[s].capture_time_sum/1e6);
+    fprintf(f, "dht_capture_duration_seconds_count{%s} %u\n", label, stats[s].reads);
+  }
+
+  write_header(f, "dht_samples_total", "counter", "Line samples taken while capturing the sensor response.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_samples_total{%s} %llu\n", label, (unsigned long long)stats[s].samples);
+  }
+
+  write_header(f, "dht_pulse_width_microseconds", "histogram", "Width of received data bit pulses.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    count = 0;
+    for (i=0; i<DHT_PULSE_HIST_BINS-1; i++) {
+      count += stats[s].pulse_hist[i];
+      fprintf(f, "dht_pulse_width_microseconds_bucket{%s,le=\"%d\"} %u\n",
+              label, (i+1)*DHT_PULSE_HIST_WIDTH, count);
+    }
+    count += stats[s].pulse_hist[i];
+    fprintf(f, "dht_pulse_width_microseconds_bucket{%s,le=\"+Inf\"} %u\n", label, count);
+    fprintf(f, "dht_pulse_width_microseconds_sum{%s} %llu\n", label, (unsigned long long)stats[s].pulse_sum);
+    fprintf(f, "dht_pulse_width_microseconds_count{%s} %u\n", label, count);
+  }
+
+  write_header(f, "dht_threshold_margin_microseconds", "gauge", "Smallest distance of a data bit pulse from the 0/1 threshold.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    if (stats[s].min_margin == NO_MARGIN) continue;
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_threshold_margin_microseconds{%s} %u\n", label, stats[s].min_margin);
+  }
+
+  write_header(f, "dht_retries_total", "counter", "Read retries done by the retry policy.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_retries_total{%s} %u\n", label, stats[s].retries);
+  }
+
+  write_header(f, "dht_resets_total", "counter", "Sensor resets done by the retry policy.");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_resets_total{%s} %u\n", label, dhtHealthInfo(s)->resets);
+  }
+
+  write_header(f, "dht_health", "gauge", "Sensor health (0=ok, 1=degraded, 2=dead).");
+  for (s=0; dhtSensorPin(s) >= 0; s++) {
+    sensor_label(label, sizeof(label), s);
+    fprintf(f, "dht_health{%s} %d\n", label, dhtHealthInfo(s)->health);
+  }
+
+  if (fclose(f) != 0 || rename(tmpname, filename) < 0) {
+    fprintf(stderr, "Unable to write %s: %s\n", filename, strerror(errno));
+    unlink(tmpname);
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,166 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  This is the implementation of the trace buffer. During a sensor
+  transaction the transports write raw records of the line events
+  into a preallocated ring. The records are decoded only after the
+  transaction has finished, so tracing does not distort the timing
+  being traced.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dht.h"
+#include "dht_trace.h"
+
+#if DHT_TRACE
+
+DHT_TRACE_RECORD_t dht_trace_ring[DHT_TRACE_SIZE];
+uint32_t dht_trace_head;
+DHT_TRACE_MODE_t dht_trace_mode = TRACE_OFF;
+
+static const char *event_names[] = {
+  "EDGE", "START", "RELEASE", "INPUT", "TIMEOUT", "CHECKSUM"
+};
+
+
+/*********************************************************************
+ * LIBRARY INTERNAL FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtTraceBegin()
+ *
+ * Description: Clears the trace buffer before a new transaction
+ *
+ ********************************************************************/
+void dhtTraceBegin(void)
+{
+  dht_trace_head = 0;
+}
+
+/*********************************************************************
+ * Function:    dhtTraceEnd()
+ *
+ * Description: Dumps the trace of the finished transaction if
+ *              requested
+ *
+ ********************************************************************/
+void dhtTraceEnd(void)
+{
+  if (dht_trace_mode == TRACE_DUMP)
+    dhtTraceDump(stderr);
+}
+
+
+/*********************************************************************
+ * PUBLIC FUNCTIONS
+ ********************************************************************/
+
+/*********************************************************************
+ * Function:    dhtTraceEnable()
+ *
+ * Description: Enable or disable tracing of the sensor transactions
+ *
+ * Parameters:  mode - trace mode
+ *
+ ********************************************************************/
+void dhtTraceEnable(DHT_TRACE_MODE_t mode)
+{
+  dht_trace_mode = mode;
+}
+
+/*********************************************************************
+ * Function:    getTrace()
+ *
+ * Description: get the trace records of the latest sensor reading
+ *
+ * Parameters:  records (out) : buffer for trace records
+ *              max (in)      : size of the buffer
+ *
+ * Return:      number of records copied to the buffer
+ *
+ ********************************************************************/
+int getTrace(DHT_TRACE_RECORD_t *records, int max)
+{
+  uint32_t first = 0;
+  int i, n;
+
+  // the ring keeps only the latest records of a long transaction
+  if (dht_trace_head > DHT_TRACE_SIZE)
+    first = dht_trace_head - DHT_TRACE_SIZE;
+  n = dht_trace_head - first;
+  if (n > max)
+    n = max;
+
+  for (i=0; i<n; i++)
+    records[i] = dht_trace_ring[(first+i) & (DHT_TRACE_SIZE-1)];
+
+  return n;
+}
+
+/*********************************************************************
+ * Function:    dhtTraceDump()
+ *
+ * Description: Prints the trace records of the latest sensor reading
+ *              in human readable form
+ *
+ * Parameters:  stream - output stream
+ *
+ ********************************************************************/
+void dhtTraceDump(FILE *stream)
+{
+  DHT_TRACE_RECORD_t records[DHT_TRACE_SIZE];
+  uint32_t prev;
+  int i, n;
+
+  n = getTrace(records, DHT_TRACE_SIZE);
+  fprintf(stream, "trace: %d records\n", n);
+  if (n == 0)
+    return;
+
+  fprintf(stream, "    time  delta event    edge level value\n");
+  prev = records[0].time;
+  for (i=0; i<n; i++) {
+    fprintf(stream, "%8u %6u %-8s %4d %5u %5u\n",
+            records[i].time - records[0].time,
+            records[i].time - prev,
+            records[i].event <= TRACE_CHECKSUM ? event_names[records[i].event] : "?",
+            records[i].edge, records[i].level, records[i].value);
+    prev = records[i].time;
+  }
+}
+
+#else /* tracing disabled at build time */
+
+void dhtTraceBegin(void) { }
+void dhtTraceEnd(void) { }
+
+void dhtTraceEnable(DHT_TRACE_MODE_t mode)
+{
+  if (mode != TRACE_OFF)
+    fprintf(stderr, "WARNING: libdht was built without trace support\n");
+}
+
+int getTrace(DHT_TRACE_RECORD_t *records, int max)
+{
+  return 0;
+}
+
+void dhtTraceDump(FILE *stream)
+{
+  fprintf(stream, "trace: not supported\n");
+}
+
+#endif /*DHT_TRACE*/
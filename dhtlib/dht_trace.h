@@ -0,0 +1,60 @@
+/************************************************************************
+
+  This file is part of the libdht "DHT Temperature & Humidity Sensor"
+  library.
+
+  Library internal definitions of the trace buffer. The TRACE() macro
+  is meant to be used inside the timing critical sampling loops: when
+  tracing is disabled at runtime it costs a single test, when it is
+  disabled at build time (DHT_TRACE=0) it compiles to nothing.
+
+  Author: Ondrej Wisniewski
+
+  Changelog:
+   18-10-2026: Initial version
+
+************************************************************************/
+
+#ifndef dht_trace_h
+#define dht_trace_h
+
+#include "dht.h"
+
+// Build time switch: set to 0 to remove all tracing code
+#ifndef DHT_TRACE
+#define DHT_TRACE 1
+#endif
+
+// Number of records in trace ring (must be a power of 2)
+#define DHT_TRACE_SIZE 256
+
+#if DHT_TRACE
+
+extern DHT_TRACE_RECORD_t dht_trace_ring[DHT_TRACE_SIZE];
+extern uint32_t dht_trace_head;
+extern DHT_TRACE_MODE_t dht_trace_mode;
+
+// The arguments are only evaluated when tracing is enabled
+#define TRACE(_event, _time, _edge, _level, _value)                       \
+  do {                                                                    \
+    if (dht_trace_mode) {                                                 \
+      DHT_TRACE_RECORD_t *_r =                                            \
+        &dht_trace_ring[dht_trace_head++ & (DHT_TRACE_SIZE-1)];           \
+      _r->event = (_event);                                               \
+      _r->time  = (_time);                                                \
+      _r->edge  = (_edge);                                                \
+      _r->level = (_level);                                               \
+      _r->value = (_value);                                               \
+    }                                                                     \
+  } while (0)
+
+#define TRACE_ENABLED (dht_trace_mode != TRACE_OFF)
+
+#else
+
+#define TRACE(_event, _time, _edge, _level, _value) do { } while (0)
+#define TRACE_ENABLED 0
+
+#endif /*DHT_TRACE*/
+
+#endif /*dht_trace_h*/
@@ -1,12 +1,26 @@
 /************************************************************************
-  This is an example program which uses the DHT Temperature & Humidity 
+  This is an example program which uses the DHT Temperature & Humidity
   Sensor library for use on FoxG20 embedded Linux board (by ACME Systems).
 
+  By default the sensor is read once. With --interval and --count the
+  sensor stays set up and is read repeatedly, writing one line (text,
+  csv, json) or record (binary) per reading to stdout, for streaming
+  into pipes:
+
+    dhtsensor --interval=10000 --format=csv DHT22 4 | logger
+
+  Binary records are 10 bytes, little endian:
+    uint32   time of the reading (seconds since the epoch)
+    uint8    result of the reading (DHT_ERROR_t)
+    uint8    reserved
+    int16    temperature (1/10 °C)
+    int16    relative humidity (1/10 %)
+
   Author: Ondrej Wisniewski
-  
+
   Build command (make sure to have dhtlib built and installed):
   gcc -o dhtsensor dhtsensor.c -ldht
-  
+
 ************************************************************************/
 
 #include <stdio.h>
@@ -14,97 +28,296 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
 
 #include "dht.h"
 
-#define MAX_RETRIES 3
+typedef enum {
+   FORMAT_TEXT,
+   FORMAT_CSV,
+   FORMAT_JSON,
+   FORMAT_BINARY
+}
+FORMAT_t;
+
+static volatile int running = 1;
+
+
+/*********************************************************************
+ * Function:    millis()
+ *
+ * Description: Reads the current monotonic time in ms
+ *
+ ********************************************************************/
+static uint32_t millis(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*********************************************************************
+ * Function:    tenths()
+ *
+ * Description: Formats a value given in tenths as decimal number
+ *
+ ********************************************************************/
+static const char *tenths(char *buf, int len, int16_t v)
+{
+   snprintf(buf, len, "%s%d.%d", (v < 0) ? "-" : "", abs(v)/10, abs(v)%10);
+   return buf;
+}
+
+/*********************************************************************
+ * Function:    print_reading()
+ *
+ * Description: Writes the latest reading in the given format
+ *
+ ********************************************************************/
+static void print_reading(FORMAT_t format, time_t now)
+{
+   /* Use the integer values to avoid floating point arithmetic */
+   int16_t h = getHumidityTenths();
+   int16_t t = getTemperatureTenths();
+   int ok = (getStatus() == ERROR_NONE);
+   char tb[16], hb[16];
+   uint8_t rec[10];
+
+   switch (format)
+   {
+      case FORMAT_TEXT:
+         if (ok)
+         {
+            printf("Rel. Humidity: %3s %%\n", tenths(hb, sizeof(hb), h));
+            printf("Temperature:   %3s °C\n", tenths(tb, sizeof(tb), t));
+         }
+         else
+         {
+            printf("Error reading sensor: %s%s\n", getStatusString(),
+                   (getHealth() == HEALTH_DEAD) ? " (sensor dead)" : "");
+         }
+         break;
+
+      case FORMAT_CSV:
+         if (ok)
+            printf("%ld,%s,%s,%s\n", (long)now, getStatusString(),
+                   tenths(tb, sizeof(tb), t), tenths(hb, sizeof(hb), h));
+         else
+            printf("%ld,%s,,\n", (long)now, getStatusString());
+         break;
+
+      case FORMAT_JSON:
+         if (ok)
+            printf("{\"time\":%ld,\"status\":\"%s\",\"temperature\":%s,\"humidity\":%s}\n",
+                   (long)now, getStatusString(),
+                   tenths(tb, sizeof(tb), t), tenths(hb, sizeof(hb), h));
+         else
+            printf("{\"time\":%ld,\"status\":\"%s\",\"temperature\":null,\"humidity\":null}\n",
+                   (long)now, getStatusString());
+         break;
+
+      case FORMAT_BINARY:
+         rec[0] = now; rec[1] = now>>8; rec[2] = now>>16; rec[3] = now>>24;
+         rec[4] = getStatus();
+         rec[5] = 0;
+         rec[6] = t; rec[7] = (uint16_t)t>>8;
+         rec[8] = h; rec[9] = (uint16_t)h>>8;
+         fwrite(rec, 1, sizeof(rec), stdout);
+         break;
+   }
+}
+
+/*********************************************************************
+ * Function:    doExit()
+ *
+ * Description: Signal handler to stop after the current reading
+ *
+ ********************************************************************/
+static void doExit(int signum)
+{
+   running = 0;
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("dhtsensor - read temperature and humidity data from DHT11 and DHT22 sensors\n\n");
+   printf("Usage: dhtsensor [options] <sensor type> [<data pin>] [<power pin>]\n");
+   printf("       sensor type: DHT11|DHT22|AM2320|SHT3X|SHT3X_ALT \n");
+   printf("       data pin:    Kernel Id of GPIO data pin (not needed for SPI communication mode),\n");
+   printf("                    I2C bus number for AM2320 and SHT3X\n");
+   printf("       power pin:   Kernel Id of GPIO power pin (optional)\n");
+   printf("Options:\n");
+   printf("       --interval=<ms>|auto  read continuously, every <ms> or as often as the\n");
+   printf("                             readings change (adaptive, max 5 minutes)\n");
+   printf("       --count=<n>           number of readings (default: 1, with --interval 0 = until interrupted)\n");
+   printf("       --format=<format>     text|csv|json|binary (default: text)\n");
+   printf("       --batch=<n>           write output in batches of <n> readings (default: 1)\n");
+}
 
 
 int main(int argc, char* argv[])
 {
+   static const struct option options[] = {
+      { "interval", required_argument, NULL, 'i' },
+      { "count",    required_argument, NULL, 'n' },
+      { "format",   required_argument, NULL, 'f' },
+      { "batch",    required_argument, NULL, 'b' },
+      { "help",     no_argument,       NULL, 'h' },
+      { NULL, 0, NULL, 0 }
+   };
    uint8_t data_pin  = 0;
    uint8_t power_pin  = 0;
    DHT_MODEL_t model = AUTO_DETECT;
-   int retry = MAX_RETRIES;
- 
-   
+   DHT_POLICY_t policy = {
+      .max_retries     = 3,
+      .timeout_backoff = 2000,
+      .max_backoff     = 8000,
+      .reset_threshold = 2,
+      .dead_threshold  = 0,
+      .power_pin       = 0
+   };
+   DHT_SCHEDULE_t schedule = {
+      .max_interval  = 300000,
+      .temp_step     = 2,
+      .humidity_step = 10
+   };
+   FORMAT_t format = FORMAT_TEXT;
+   unsigned long interval = 0;
+   unsigned long count = 1;
+   unsigned long batch = 1;
+   unsigned long n;
+   int adaptive = 0;
+   int count_set = 0;
+   uint32_t start, elapsed;
+   int opt;
+
+
    /* Parse command line */
-   switch (argc)
-   {   
-      case 2:  /* 1 paramters provided */
-      case 3:  /* 2 paramters provided */
-      case 4:  /* 3 paramters provided */
-         /* Get first parameter: sensor type */ 
-         if (strcmp(argv[1], "DHT11")==0) model = DHT11;
-         else if (strcmp(argv[1], "DHT22")==0) model = DHT22;
-         else
-         {
-            printf("Unknown sensor model %s\n", argv[1]);
+   while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1)
+   {
+      switch (opt)
+      {
+         case 'i':
+            if (strcmp(optarg, "auto")==0) adaptive = 1;
+            else interval = strtoul(optarg, NULL, 0);
+            break;
+         case 'n':
+            count = strtoul(optarg, NULL, 0);
+            count_set = 1;
+            break;
+         case 'f':
+            if (strcmp(optarg, "text")==0) format = FORMAT_TEXT;
+            else if (strcmp(optarg, "csv")==0) format = FORMAT_CSV;
+            else if (strcmp(optarg, "json")==0) format = FORMAT_JSON;
+            else if (strcmp(optarg, "binary")==0) format = FORMAT_BINARY;
+            else
+            {
+               printf("Unknown output format %s\n", optarg);
+               return -1;
+            }
+            break;
+         case 'b':
+            batch = strtoul(optarg, NULL, 0);
+            if (batch == 0) batch = 1;
+            break;
+         default:
+            usage();
             return -1;
-         }
+      }
+   }
 
-         /* Get second parameter: data pin */ 
-         if (argc==3)
-         {
-            /* Get Kernel Id of data pin */
-            data_pin = atoi(argv[2]);
-         }
-         
-         /* Get third parameter: power pin */ 
-         if (argc==4)
-         {
-            /* Get Kernel Id of power pin */
-            power_pin = atoi(argv[3]);
-         }
-      break;
-      
-      default: /* print help message */
-         printf("dhtsensor - read temperature and humidity data from DHT11 and DHT22 sensors\n\n");
-         printf("Usage: dhtsensor <sensor type> [<data pin>] [<power pin>]\n");
-         printf("       sensor type: DHT11|DHT22 \n");
-         printf("       data pin:    Kernel Id of GPIO data pin (not needed for SPI communication mode)\n");
-         printf("       power pin:   Kernel Id of GPIO power pin (optional)\n");
-         return -1;
+   if (optind >= argc || argc - optind > 3)
+   {
+      usage();
+      return -1;
+   }
+
+   /* Get first parameter: sensor type */
+   if (strcmp(argv[optind], "DHT11")==0) model = DHT11;
+   else if (strcmp(argv[optind], "DHT22")==0) model = DHT22;
+   else if (strcmp(argv[optind], "AM2320")==0) model = AM2320;
+   else if (strcmp(argv[optind], "SHT3X")==0) model = SHT3X;
+   else if (strcmp(argv[optind], "SHT3X_ALT")==0) model = SHT3X_ALT;
+   else
+   {
+      printf("Unknown sensor model %s\n", argv[optind]);
+      return -1;
    }
 
+   /* Get second parameter: Kernel Id of data pin */
+   if (argc - optind >= 2)
+      data_pin = atoi(argv[optind+1]);
+
+   /* Get third parameter: Kernel Id of power pin */
+   if (argc - optind == 3)
+      power_pin = atoi(argv[optind+2]);
+
+   /* Stream until interrupted unless a count is given */
+   if ((interval || adaptive) && !count_set)
+      count = 0;
+
+   /* Output is written in batches, not as the stdio default for pipes */
+   setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
+
+   signal(SIGTERM, doExit);
+   signal(SIGINT, doExit);
+
    /* Power on the sensor */
    if (power_pin) dhtPoweron(power_pin);
-   
+
    /* Init sensor communication */
    dhtSetup(data_pin, model);
    if (getStatus() != ERROR_NONE)
    {
-      printf("Error during setup: %s\n", getStatusString());
+      fprintf(stderr, "Error during setup: %s\n", getStatusString());
       return -1;
    }
 
-   /* Read sensor with retry */
-   do    
+   /* Read sensor with retry (and reset if we control its power) */
+   policy.power_pin = power_pin;
+   dhtSetPolicy(&policy);
+   if (adaptive)
+      dhtSetSchedule(&schedule);
+
+   if (format == FORMAT_CSV)
+      printf("time,status,temperature,humidity\n");
+
+   for (n=0; running && (count == 0 || n < count); n++)
    {
-      readSensor();
-   
-      if (getStatus() == ERROR_NONE)
-      {
-         printf("Rel. Humidity: %3.1f %%\n", getHumidity());
-         printf("Temperature:   %3.1f °C\n", getTemperature());
-      }
+      start = millis();
+      readSensorRetry();
+      print_reading(format, time(NULL));
+      if ((n+1) % batch == 0)
+         fflush(stdout);
+
+      if (count && n+1 == count)
+         break;
+
+      /* Wait for the next reading */
+      if (adaptive)
+         usleep(dhtNextRead()*1000);
       else
       {
-         sleep(2);
+         elapsed = millis() - start;
+         if (elapsed < interval)
+            usleep((interval - elapsed)*1000);
       }
    }
-   while ((getStatus() != ERROR_NONE) && retry--);
-   
-   if (getStatus() != ERROR_NONE)
-   {
-      printf("Error reading sensor: %s\n", getStatusString());
-   }
-   
+   fflush(stdout);
+
    /* Cleanup */
    dhtCleanup();
 
    /* Power off the sensor */
    if (power_pin) dhtPoweroff(power_pin);
-   
+
    return 0;
 }
@@ -0,0 +1,48 @@
+/************************************************************************
+  Definition of the compact binary capture format written by dht-capture
+  and read by the offline decoder tools.
+
+  A capture file starts with an 8 byte file header, followed by one
+  record per sensor transaction. All numbers are little endian.
+
+  File header:
+    char[6]  magic "DHTCAP"
+    uint8    format version (1)
+    uint8    reserved
+
+  Record header:
+    uint8    type (CAPTURE_SPI or CAPTURE_EDGES)
+    uint8    sensor model (DHT_MODEL_t)
+    uint8    result of the reading (DHT_ERROR_t)
+    uint8    reserved
+    uint32   timestamp of the transaction (ms, monotonic)
+    uint32   rate (Hz): SPI sample rate, 1000000 for edge timestamps
+    uint32   count: number of SPI samples or number of edges
+    uint32   start: sample index where the host released the data
+             line (SPI only)
+
+  Record payload:
+    CAPTURE_SPI:   (count+7)/8 bytes of line samples (MSB first)
+    CAPTURE_EDGES: count x uint32, bit 31 is the line level after the
+                   edge, bits 0-30 the time of the edge in us relative
+                   to the host start signal
+
+  Author: Ondrej Wisniewski
+
+************************************************************************/
+
+#ifndef capture_format_h
+#define capture_format_h
+
+#define CAPTURE_MAGIC       "DHTCAP"
+#define CAPTURE_VERSION     1
+#define CAPTURE_FILE_HDR    8
+#define CAPTURE_RECORD_HDR  20
+
+#define CAPTURE_SPI         0
+#define CAPTURE_EDGES       1
+
+#define CAPTURE_LEVEL       0x80000000
+#define CAPTURE_TIME_MASK   0x7FFFFFFF
+
+#endif /*capture_format_h*/
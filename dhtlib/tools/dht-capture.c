@@ -0,0 +1,389 @@
+/************************************************************************
+  dht-capture - Record the raw waveform of DHT sensor transactions
+
+  Reads the sensor repeatedly via the DHT library and writes the raw
+  line samples (SPI mode) or edge timestamps (GPIO mode) of each
+  transaction to a file, either as VCD (to be viewed with PulseView/
+  sigrok or GTKWave) or in the compact binary format described in
+  capture_format.h (to be replayed by the offline decoder tools).
+  Each transaction is written as soon as it has finished, so long
+  sessions can be recorded without buffering them in memory.
+
+  Author: Ondrej Wisniewski
+
+  Build command (make sure to have dhtlib built and installed):
+  gcc -o dht-capture dht-capture.c -ldht
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "dht.h"
+#include "capture_format.h"
+
+#define MAX_CAPTURE_BYTES 4096
+#define MAX_EDGES 256
+
+typedef enum {
+   FORMAT_VCD,
+   FORMAT_BIN
+}
+FORMAT_t;
+
+/* Data of the latest transaction */
+static uint8_t  spi_data[MAX_CAPTURE_BYTES];
+static uint32_t spi_rate;
+static uint32_t spi_start;
+static uint32_t spi_samples;
+
+static uint32_t edges[MAX_EDGES];
+static uint32_t num_edges;
+
+static volatile int running = 1;
+
+
+/*********************************************************************
+ * Function:    spi_capture()
+ *
+ * Description: Capture handler, stores the raw line samples of the
+ *              latest SPI transaction
+ *
+ ********************************************************************/
+static void spi_capture(const DHT_CAPTURE_t *capture)
+{
+   uint32_t len = (capture->num_samples+7)/8;
+
+   if (len > MAX_CAPTURE_BYTES)
+      len = MAX_CAPTURE_BYTES;
+   memcpy(spi_data, capture->data, len);
+   spi_rate = capture->rate;
+   spi_start = capture->start;
+   spi_samples = (capture->num_samples < len*8 ? capture->num_samples : len*8);
+}
+
+/*********************************************************************
+ * Function:    gpio_capture()
+ *
+ * Description: Extracts the edges of the latest GPIO transaction from
+ *              the trace buffer
+ *
+ ********************************************************************/
+static void gpio_capture(void)
+{
+   static DHT_TRACE_RECORD_t records[MAX_EDGES];
+   uint32_t t0 = 0;
+   int i, n;
+
+   n = getTrace(records, MAX_EDGES);
+   num_edges = 0;
+   for (i=0; i<n; i++)
+   {
+      switch (records[i].event)
+      {
+         case TRACE_START:
+            t0 = records[i].time;
+            /* fall through */
+         case TRACE_RELEASE:
+         case TRACE_EDGE:
+            edges[num_edges++] = ((records[i].time - t0) & CAPTURE_TIME_MASK) |
+                                 (records[i].level ? CAPTURE_LEVEL : 0);
+            break;
+      }
+   }
+}
+
+/*********************************************************************
+ * Function:    put_le32()
+ *
+ * Description: Writes a 32 bit number in little endian byte order
+ *
+ ********************************************************************/
+static void put_le32(FILE *f, uint32_t v)
+{
+   uint8_t b[4] = { v, v>>8, v>>16, v>>24 };
+   fwrite(b, 1, 4, f);
+}
+
+/*********************************************************************
+ * Function:    write_bin_header()
+ *
+ * Description: Writes the file header of a binary capture file
+ *
+ ********************************************************************/
+static void write_bin_header(FILE *f)
+{
+   fwrite(CAPTURE_MAGIC, 1, 6, f);
+   fputc(CAPTURE_VERSION, f);
+   fputc(0, f);
+}
+
+/*********************************************************************
+ * Function:    write_bin_record()
+ *
+ * Description: Writes the latest transaction as binary capture record
+ *
+ ********************************************************************/
+static void write_bin_record(FILE *f, int spi, DHT_MODEL_t model,
+                             DHT_ERROR_t result, uint32_t timestamp)
+{
+   uint32_t i;
+
+   fputc(spi ? CAPTURE_SPI : CAPTURE_EDGES, f);
+   fputc(model, f);
+   fputc(result, f);
+   fputc(0, f);
+   put_le32(f, timestamp);
+   put_le32(f, spi ? spi_rate : 1000000);
+   put_le32(f, spi ? spi_samples : num_edges);
+   put_le32(f, spi ? spi_start : 0);
+
+   if (spi)
+      fwrite(spi_data, 1, (spi_samples+7)/8, f);
+   else
+      for (i=0; i<num_edges; i++)
+         put_le32(f, edges[i]);
+}
+
+/*********************************************************************
+ * Function:    write_vcd_header()
+ *
+ * Description: Writes the header of a VCD file
+ *
+ ********************************************************************/
+static void write_vcd_header(FILE *f)
+{
+   time_t now = time(NULL);
+
+   fprintf(f, "$date %s$end\n", ctime(&now));
+   fprintf(f, "$version dht-capture $end\n");
+   fprintf(f, "$timescale 1us $end\n");
+   fprintf(f, "$scope module dht $end\n");
+   fprintf(f, "$var wire 1 ! data $end\n");
+   fprintf(f, "$var reg 2 \" result $end\n");
+   fprintf(f, "$upscope $end\n");
+   fprintf(f, "$enddefinitions $end\n");
+   fprintf(f, "#0\n$dumpvars\n1!\nb0 \"\n$end\n");
+}
+
+/*********************************************************************
+ * Function:    write_vcd_record()
+ *
+ * Description: Writes the latest transaction as VCD value changes
+ *              (time is relative to the first transaction)
+ *
+ ********************************************************************/
+static void write_vcd_record(FILE *f, int spi, DHT_ERROR_t result, uint64_t base)
+{
+   uint64_t t = base;
+   uint32_t i;
+   int level = -1, bit;
+
+   if (spi)
+   {
+      for (i=0; i<spi_samples; i++)
+      {
+         bit = (spi_data[i/8] & 0x80>>(i%8)) ? 1 : 0;
+         if (bit != level)
+         {
+            t = base + ((uint64_t)i * 1000000) / spi_rate;
+            fprintf(f, "#%llu\n%d!\n", (unsigned long long)t, bit);
+            level = bit;
+         }
+      }
+   }
+   else
+   {
+      for (i=0; i<num_edges; i++)
+      {
+         t = base + (edges[i] & CAPTURE_TIME_MASK);
+         fprintf(f, "#%llu\n%d!\n", (unsigned long long)t,
+                 (edges[i] & CAPTURE_LEVEL) ? 1 : 0);
+      }
+   }
+
+   /* Back to idle level, then show the result of the reading */
+   fprintf(f, "#%llu\n1!\nb%d%d \"\n", (unsigned long long)t+1,
+           (result>>1) & 1, result & 1);
+}
+
+/*********************************************************************
+ * Function:    millis()
+ *
+ * Description: Reads the current monotonic time in ms
+ *
+ ********************************************************************/
+static uint32_t millis(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint32_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*********************************************************************
+ * Function:    doExit()
+ *
+ * Description: Signal handler to stop the capture after the current
+ *              transaction
+ *
+ ********************************************************************/
+static void doExit(int signum)
+{
+   running = 0;
+}
+
+/*********************************************************************
+ * Function:    usage()
+ *
+ * Description: Prints the help message
+ *
+ ********************************************************************/
+static void usage(void)
+{
+   printf("dht-capture - record raw waveforms of DHT11 and DHT22 sensor transactions\n\n");
+   printf("Usage: dht-capture [options] <sensor type> [<data pin>]\n");
+   printf("       sensor type: DHT11|DHT22 \n");
+   printf("       data pin:    Kernel Id of GPIO data pin (not needed for SPI communication mode)\n");
+   printf("Options:\n");
+   printf("       -o <file>    output file (default: stdout)\n");
+   printf("       -f vcd|bin   output format (default: vcd)\n");
+   printf("       -n <count>   number of transactions to record (default: 1, 0 = until interrupted)\n");
+   printf("       -i <ms>      interval between transactions (default: sensor duty cycle)\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+   uint8_t data_pin = 0;
+   DHT_MODEL_t model;
+   DHT_TRANSPORT_t transport;
+   FORMAT_t format = FORMAT_VCD;
+   const char *filename = NULL;
+   unsigned long count = 1, n;
+   unsigned long interval = 0;
+   uint32_t first_ts = 0, ts;
+   FILE *f = stdout;
+   int opt;
+
+   /* Parse command line */
+   while ((opt = getopt(argc, argv, "o:f:n:i:h")) != -1)
+   {
+      switch (opt)
+      {
+         case 'o':
+            filename = optarg;
+            break;
+         case 'f':
+            if (strcmp(optarg, "vcd")==0) format = FORMAT_VCD;
+            else if (strcmp(optarg, "bin")==0) format = FORMAT_BIN;
+            else
+            {
+               printf("Unknown output format %s\n", optarg);
+               return -1;
+            }
+            break;
+         case 'n':
+            count = strtoul(optarg, NULL, 0);
+            break;
+         case 'i':
+            interval = strtoul(optarg, NULL, 0);
+            break;
+         default:
+            usage();
+            return -1;
+      }
+   }
+
+   if (optind >= argc)
+   {
+      usage();
+      return -1;
+   }
+   if (strcmp(argv[optind], "DHT11")==0) model = DHT11;
+   else if (strcmp(argv[optind], "DHT22")==0) model = DHT22;
+   else
+   {
+      printf("Unknown sensor model %s\n", argv[optind]);
+      return -1;
+   }
+   if (optind+1 < argc)
+      data_pin = atoi(argv[optind+1]);
+   if (interval == 0)
+      interval = (model == DHT11 ? 1000 : 2000);
+
+   /* Init sensor communication */
+   dhtSetup(data_pin, model);
+   if (getStatus() != ERROR_NONE)
+   {
+      fprintf(stderr, "Error during setup: %s\n", getStatusString());
+      return -1;
+   }
+   /* dhtSetup() may have chosen another transport than the data pin
+      suggests (e.g. the kernel IIO driver owns the pin) */
+   transport = getTransport();
+   switch (transport)
+   {
+      case TRANSPORT_GPIO:
+         dhtTraceEnable(TRACE_ON);
+         break;
+      case TRANSPORT_SPI:
+         dhtSetCaptureHandler(spi_capture);
+         break;
+      default:
+         fprintf(stderr, "Sensor is read by the %s, no waveform available\n",
+                 transport == TRANSPORT_IIO ? "kernel IIO driver" : "I2C bus");
+         dhtCleanup();
+         return -1;
+   }
+
+   if (filename)
+   {
+      f = fopen(filename, "w");
+      if (f == NULL)
+      {
+         perror(filename);
+         dhtCleanup();
+         return -1;
+      }
+   }
+
+   signal(SIGTERM, doExit);
+   signal(SIGINT, doExit);
+
+   if (format == FORMAT_VCD)
+      write_vcd_header(f);
+   else
+      write_bin_header(f);
+
+   for (n=0; running && (count == 0 || n < count); n++)
+   {
+      if (n) usleep(interval*1000);
+      if (!running) break;
+
+      ts = millis();
+      if (n == 0) first_ts = ts;
+      readSensor();
+      if (transport == TRANSPORT_GPIO)
+         gpio_capture();
+
+      if (format == FORMAT_VCD)
+         write_vcd_record(f, transport == TRANSPORT_SPI, getStatus(), (uint64_t)(ts - first_ts)*1000);
+      else
+         write_bin_record(f, transport == TRANSPORT_SPI, model, getStatus(), ts);
+      fflush(f);
+
+      fprintf(stderr, "transaction %lu: %s\n", n+1, getStatusString());
+   }
+
+   /* Cleanup */
+   dhtCleanup();
+   if (f != stdout)
+      fclose(f);
+
+   return 0;
+}